@@ -23,25 +23,46 @@ static int icos(int deg) {
     return isin(deg + 90);
 }
 
+// Same in tenths of a degree, interpolated, for hands that sweep
+static int isin10(int d10) {
+    d10 = ((d10 % 3600) + 3600) % 3600;
+    int a = isin(d10 / 10), b = isin(d10 / 10 + 1);
+    return a + (b - a) * (d10 % 10) / 10;
+}
+
+static int icos10(int d10) {
+    return isin10(d10 + 900);
+}
+
+// End point of a clock hand, angle in tenths of a degree from 12
+static void hand_end(int cx, int cy, int angle10, int len, int *ex, int *ey) {
+    *ex = cx + (icos10(angle10 - 900) * len) / 1000;
+    *ey = cy + (isin10(angle10 - 900) * len) / 1000;
+}
+
 // Draw a clock hand
-static void draw_hand(int cx, int cy, int angle_deg, int len, int thick, u32 color) {
-    int ex = cx + (icos(angle_deg - 90) * len) / 1000;
-    int ey = cy + (isin(angle_deg - 90) * len) / 1000;
-    for (int t = -thick; t <= thick; t++) {
-        fb_draw_line(cx + t, cy, ex + t, ey, color);
-        fb_draw_line(cx, cy + t, ex, ey + t, color);
-    }
+static void draw_hand(int cx, int cy, int angle10, int len, int thick, u32 color) {
+    int ex, ey;
+    hand_end(cx, cy, angle10, len, &ex, &ey);
+    fb_draw_thick_line(cx, cy, ex, ey, color, 2 * thick + 1);
 }
 
+#define CLOCK_R     100
+#define FACE_SIZE   (2 * (CLOCK_R + 5) + 1)
+
+// The face never changes: draw it once in 32 bpp (pixels in the
+// app arena), blit it each second
+static fb_surface_t face;
+
 // Draw clock face
 static void draw_clock_face(int cx, int cy, int r) {
     // Circular background
     fb_fill_circle(cx, cy, r + 5, 0x00050F20);
     fb_fill_circle(cx, cy, r, COLOR_ARCTIC_WIN);
 
-    // Outer ring
-    for (int i = r-3; i <= r+3; i++)
-        fb_fill_circle(cx, cy, i, i == r ? COLOR_ARCTIC_ACC : 0);
+    // Outer ring: dark band with an anti-aliased accent line on radius r
+    fb_fill_ring(cx, cy, r - 3, r + 3, COLOR_BLACK);
+    fb_fill_ring_aa(cx, cy, r - 1, r + 1, COLOR_ARCTIC_ACC);
 
     // Hour markers
     for (int h = 0; h < 12; h++) {
@@ -66,11 +87,74 @@ static void draw_clock_face(int cx, int cy, int r) {
     fb_fill_circle(cx, cy, 5, COLOR_ARCTIC_ACC);
 }
 
-void app_clock_run(void) {
-    // === App window ===
-    int win_x = 60, win_y = 30;
-    int win_w = fb.width - 120;
-    int win_h = fb.height - 100;
+static wm_window_t *clock_win;
+static rtc_time_t   clock_now;
+static char         clock_str[32];
+static u32          clock_rtc_seen;     // rtc_get_updates() at clock_now
+static u64          clock_sec_ns;       // ktime_ns() when the second began
+static int          clock_sec10;        // second hand angle, tenths of a degree
+static bool         clock_new_second;
+static int          clock_drawn_end[2] = { -1, -1 };
+
+static void clock_center(wm_window_t *w, int *cx, int *cy) {
+    *cx = w->frame.x + w->frame.w/2;
+    *cy = w->frame.y + 40 + 110;
+}
+
+// Face and hands; redrawn whenever the second hand moves a pixel
+static void clock_draw_hands(wm_window_t *w) {
+    int cx, cy;
+    clock_center(w, &cx, &cy);
+    rtc_time_t t = clock_now;
+
+    // Clock face
+    fb_blit(NULL, cx - FACE_SIZE / 2, cy - FACE_SIZE / 2, &face);
+
+    // Hands
+    int min_angle   = t.minute * 60 + t.second;
+    int hour_angle  = (t.hour % 12) * 300 + t.minute * 5;
+
+    draw_hand(cx, cy, hour_angle,  60, 3, COLOR_TEXT_BRIGHT);
+    draw_hand(cx, cy, min_angle,   85, 2, COLOR_WHITE);
+    draw_hand(cx, cy, clock_sec10, 90, 1, 0x00FF4444);
+    hand_end(cx, cy, clock_sec10, 90, &clock_drawn_end[0], &clock_drawn_end[1]);
+
+    // Center dot
+    fb_fill_circle(cx, cy, 4, COLOR_ARCTIC_ACC);
+}
+
+// Digital time and date; redrawn once a second
+static void clock_draw_text(wm_window_t *w) {
+    int win_x = w->frame.x, win_y = w->frame.y;
+    int win_w = w->frame.w, win_h = w->frame.h;
+    rtc_time_t t = clock_now;
+
+    // Digital clock
+    int dbox_x = win_x + win_w/2 - 80;
+    int dbox_y = win_y + 40 + 230;
+    fb_fill_rect(dbox_x, dbox_y, 160, 36, 0x000A1A30);
+    fb_draw_rect(dbox_x, dbox_y, 160, 36, COLOR_ARCTIC_ACC, 1);
+    fb_draw_string(dbox_x + 16, dbox_y + 9, clock_str, COLOR_ARCTIC_ACC, 0x000A1A30, 2);
+
+    // Date (scratch: gone after this frame)
+    char *date_str = arena_alloc(&frame_scratch, 64);
+    if (date_str) {
+        ksprintf(date_str, "%s, %02d %s %u",
+            rtc_weekday_str(t.weekday), (u32)t.day,
+            rtc_month_str(t.month), (u32)t.year);
+        int date_x = win_x + win_w/2 - kstrlen(date_str)*4;
+        fb_fill_rect(win_x + 20, dbox_y + 42, win_w - 40, 16, COLOR_ARCTIC_WIN);
+        fb_draw_string(date_x, dbox_y + 42, date_str, COLOR_LIGHT_GRAY, COLOR_ARCTIC_WIN, 1);
+    }
+
+    // Timezone info
+    fb_draw_string(win_x + 10, win_y + win_h - 25,
+        "Time from CMOS RTC | ArcticOS v1.0", COLOR_LIGHT_GRAY, COLOR_ARCTIC_WIN, 1);
+}
+
+static void clock_paint(wm_window_t *w) {
+    int win_x = w->frame.x, win_y = w->frame.y;
+    int win_w = w->frame.w, win_h = w->frame.h;
 
     // Window background
     fb_fill_rect(win_x, win_y, win_w, win_h, COLOR_ARCTIC_WIN);
@@ -78,71 +162,74 @@ void app_clock_run(void) {
 
     // Title bar
     fb_fill_rect(win_x, win_y, win_w, 28, COLOR_ARCTIC_BAR);
-    fb_draw_string(win_x + 10, win_y + 7, "Clock / RTC", COLOR_ARCTIC_ACC, COLOR_ARCTIC_BAR, 1);
+    fb_draw_string(win_x + 10, win_y + 7, w->title, COLOR_ARCTIC_ACC, COLOR_ARCTIC_BAR, 1);
     fb_draw_string(win_x + win_w - 64, win_y + 7, "[ESC]=Exit", COLOR_LIGHT_GRAY, COLOR_ARCTIC_BAR, 1);
 
-    int cx = win_x + win_w/2;
-    int cy = win_y + 40 + 110;
-    int clock_r = 100;
+    clock_draw_hands(w);
+    clock_draw_text(w);
+}
+
+static void clock_latch(void) {
+    clock_rtc_seen = rtc_get_updates();
+    clock_sec_ns = ktime_ns();
+    rtc_get_time(&clock_now);
+    clock_now.hour = (clock_now.hour + 1) % 24; // UTC+1 (CET)
+    ksprintf(clock_str, "%02d:%02d:%02d",
+        (u32)clock_now.hour, (u32)clock_now.minute, (u32)clock_now.second);
+}
+
+// Frame client: the RTC interrupt marks the start of each second,
+// ktime_ns() fills in the milliseconds so the second hand sweeps.
+// Frames where no hand moved a whole pixel draw nothing.
+static bool clock_update(u32 now_ms) {
+    (void)now_ms;
+    if (rtc_get_updates() != clock_rtc_seen) {
+        clock_latch();
+        clock_new_second = true;
+    }
+    u32 frac = (u32)kdiv64(ktime_ns() - clock_sec_ns, 1000000, NULL);
+    if (frac > 999) frac = 999;
+    clock_sec10 = clock_now.second * 60 + (int)(frac * 60 / 1000);
+
+    int cx, cy, ex, ey;
+    clock_center(clock_win, &cx, &cy);
+    hand_end(cx, cy, clock_sec10, 90, &ex, &ey);
+    return clock_new_second || ex != clock_drawn_end[0] || ey != clock_drawn_end[1];
+}
 
-    char prev_time[32] = "";
+static void clock_draw(void) {
+    wm_begin(clock_win);
+    clock_draw_hands(clock_win);
+    if (clock_new_second) clock_draw_text(clock_win);
+    wm_end();
+    clock_new_second = false;
+}
 
+void app_clock_run(void) {
+    u32 *face_pixels = arena_alloc(&app_arena, FACE_SIZE * FACE_SIZE * 4);
+    if (!face_pixels) return;
+    fb_surface_init(&face, FACE_SIZE, FACE_SIZE, FB_FORMAT_XRGB8888, face_pixels);
+    fb_surface_t *screen = fb_set_target(&face);
+    fb_clear(COLOR_ARCTIC_WIN);
+    draw_clock_face(FACE_SIZE / 2, FACE_SIZE / 2, CLOCK_R);
+    fb_set_target(screen);
+
+    clock_latch();
+    clock_sec10 = clock_now.second * 60;
+    clock_new_second = false;
+    clock_win = wm_open(60, 30, fb.width - 120, fb.height - 100, "Clock / RTC", clock_paint);
+    if (!clock_win) return;
+
+    int client = frame_add(clock_update, clock_draw);
     while (1) {
-        rtc_time_t t;
-        rtc_read(&t);
-        t.hour = (t.hour + 1) % 24; // UTC+1 (CET)
-
-        char time_str[32];
-        ksprintf(time_str, "%02d:%02d:%02d", (u32)t.hour, (u32)t.minute, (u32)t.second);
-
-        // Redraw only when time has changed
-        if (kstrcmp(time_str, prev_time) != 0) {
-            kstrcpy(prev_time, time_str);
-
-            // Clock face
-            draw_clock_face(cx, cy, clock_r);
-
-            // Hands
-            int sec_angle   = t.second * 6;
-            int min_angle   = t.minute * 6 + t.second / 10;
-            int hour_angle  = (t.hour % 12) * 30 + t.minute / 2;
-
-            draw_hand(cx, cy, hour_angle,  60, 3, COLOR_TEXT_BRIGHT);
-            draw_hand(cx, cy, min_angle,   85, 2, COLOR_WHITE);
-            draw_hand(cx, cy, sec_angle,   90, 1, 0x00FF4444);
-
-            // Center dot
-            fb_fill_circle(cx, cy, 4, COLOR_ARCTIC_ACC);
-
-            // Digital clock
-            int dbox_x = win_x + win_w/2 - 80;
-            int dbox_y = win_y + 40 + 230;
-            fb_fill_rect(dbox_x, dbox_y, 160, 36, 0x000A1A30);
-            fb_draw_rect(dbox_x, dbox_y, 160, 36, COLOR_ARCTIC_ACC, 1);
-            fb_draw_string(dbox_x + 16, dbox_y + 9, time_str, COLOR_ARCTIC_ACC, 0x000A1A30, 2);
-
-            // Date
-            char date_str[64];
-            ksprintf(date_str, "%s, %02d %s %u",
-                rtc_weekday_str(t.weekday), (u32)t.day,
-                rtc_month_str(t.month), (u32)t.year);
-            int date_x = win_x + win_w/2 - kstrlen(date_str)*4;
-            fb_fill_rect(win_x + 20, dbox_y + 42, win_w - 40, 16, COLOR_ARCTIC_WIN);
-            fb_draw_string(date_x, dbox_y + 42, date_str, COLOR_LIGHT_GRAY, COLOR_ARCTIC_WIN, 1);
-
-            // Timezone info
-            fb_draw_string(win_x + 10, win_y + win_h - 25,
-                "Time from CMOS RTC | ArcticOS v1.0", COLOR_LIGHT_GRAY, COLOR_ARCTIC_WIN, 1);
-        }
+        frame_wait(true);
 
         // Keyboard input
         if (keyboard_has_char()) {
             char c = keyboard_getchar();
             if (c == 27 || c == 'q' || c == 'Q') break;
         }
-
-        // Wait ~100ms
-        u32 wait_end = timer_get_ticks() + 10;
-        while (timer_get_ticks() < wait_end) __asm__("hlt");
     }
+    frame_remove(client);
+    wm_close(clock_win);
 }
@@ -4,8 +4,9 @@
 #define ED_COLS   72
 #define ED_LINES  200
 
-static char ed_lines[ED_LINES][ED_COLS + 1];
-static int  ed_line_len[ED_LINES];
+static char *ed_lines[ED_LINES];     // objects from ed_line_cache
+static int   ed_line_len[ED_LINES];
+static kmem_cache_t *ed_line_cache;
 static int  ed_total_lines = 1;
 static int  ed_cur_row = 0;   // cursor: buffer row
 static int  ed_cur_col = 0;   // cursor: column
@@ -14,6 +15,7 @@ static int  ed_ox, ed_oy;     // pixel offset
 static bool ed_modified = false;
 static char ed_filename[64] = "note.txt";
 static char ed_status[128]  = "";
+static wm_window_t *ed_win;
 
 // ============================================================
 // EDITOR RENDERING
@@ -118,8 +120,9 @@ static void ed_delete_char(void) {
             ed_line_len[ed_cur_row - 1] = prev_len + len;
             prev[prev_len + len] = '\0';
             // Delete current line
+            kmem_cache_free(ed_line_cache, line);
             for (int r = ed_cur_row; r < ed_total_lines - 1; r++) {
-                kmemcpy(ed_lines[r], ed_lines[r+1], ed_line_len[r+1]);
+                ed_lines[r] = ed_lines[r+1];
                 ed_line_len[r] = ed_line_len[r+1];
             }
             ed_total_lines--;
@@ -142,14 +145,17 @@ static void ed_newline(void) {
     if (ed_total_lines >= ED_LINES) return;
     char *line = ed_lines[ed_cur_row];
     int   len  = ed_line_len[ed_cur_row];
+    char *next = kmem_cache_alloc(ed_line_cache);
+    if (!next) return;
     // Shift lines down
     for (int r = ed_total_lines; r > ed_cur_row + 1; r--) {
-        kmemcpy(ed_lines[r], ed_lines[r-1], ed_line_len[r-1]);
+        ed_lines[r] = ed_lines[r-1];
         ed_line_len[r] = ed_line_len[r-1];
     }
     // New line = rest of current line
     int rest = len - ed_cur_col;
-    kmemcpy(ed_lines[ed_cur_row + 1], line + ed_cur_col, rest);
+    ed_lines[ed_cur_row + 1] = next;
+    kmemcpy(next, line + ed_cur_col, rest);
     ed_line_len[ed_cur_row + 1] = rest;
     // Truncate current line
     ed_line_len[ed_cur_row] = ed_cur_col;
@@ -160,50 +166,16 @@ static void ed_newline(void) {
     ed_render_all();
 }
 
-// ============================================================
-// MAIN EDITOR LOOP
-// ============================================================
-void app_editor_run(void) {
-    // Initialize buffer
-    kmemset(ed_lines, 0, sizeof(ed_lines));
-    kmemset(ed_line_len, 0, sizeof(ed_line_len));
-    ed_total_lines = 1;
-    ed_cur_row = ed_cur_col = ed_scroll = 0;
-    ed_modified = false;
-
-    // Insert welcome text
-    const char *welcome = "Welcome to ArcticOS Editor!";
-    kstrcpy(ed_lines[0], welcome);
-    ed_line_len[0] = kstrlen(welcome);
-    kstrcpy(ed_lines[1], "");
-    ed_line_len[1] = 0;
-    kstrcpy(ed_lines[2], "Keyboard shortcuts:");
-    ed_line_len[2] = kstrlen(ed_lines[2]);
-    kstrcpy(ed_lines[3], "  Arrow keys - move cursor");
-    ed_line_len[3] = kstrlen(ed_lines[3]);
-    kstrcpy(ed_lines[4], "  Home/End   - start/end of line");
-    ed_line_len[4] = kstrlen(ed_lines[4]);
-    kstrcpy(ed_lines[5], "  PgUp/PgDn  - page up/down");
-    ed_line_len[5] = kstrlen(ed_lines[5]);
-    kstrcpy(ed_lines[6], "  ESC        - return to desktop");
-    ed_line_len[6] = kstrlen(ed_lines[6]);
-    kstrcpy(ed_lines[7], "");
-    ed_line_len[7] = 0;
-    kstrcpy(ed_lines[8], "Start typing below...");
-    ed_line_len[8] = kstrlen(ed_lines[8]);
-    ed_total_lines = 10;
-
-    // Window
-    int win_x = 20, win_y = 20;
-    int win_w = fb.width - 40;
-    int win_h = fb.height - 60;
+static void ed_paint(wm_window_t *w) {
+    int win_x = w->frame.x, win_y = w->frame.y;
+    int win_w = w->frame.w, win_h = w->frame.h;
 
     fb_fill_rect(win_x, win_y, win_w, win_h, 0x00050F18);
     fb_draw_rect(win_x, win_y, win_w, win_h, COLOR_ARCTIC_ACC, 2);
 
     // Title bar
     fb_fill_rect(win_x, win_y, win_w, 26, COLOR_ARCTIC_BAR);
-    fb_draw_string(win_x + 10, win_y + 6, "Text Editor - ArcticOS", COLOR_ARCTIC_ACC, COLOR_ARCTIC_BAR, 1);
+    fb_draw_string(win_x + 10, win_y + 6, w->title, COLOR_ARCTIC_ACC, COLOR_ARCTIC_BAR, 1);
     fb_draw_string(win_x + win_w - 64, win_y + 6, "[ESC]=Exit", COLOR_LIGHT_GRAY, COLOR_ARCTIC_BAR, 1);
 
     ed_ox = win_x + 4;
@@ -211,16 +183,67 @@ void app_editor_run(void) {
 
     ed_render_all();
     ed_update_status();
+}
+
+static void ed_free_lines(void) {
+    for (int r = 0; r < ed_total_lines; r++)
+        kmem_cache_free(ed_line_cache, ed_lines[r]);
+    ed_total_lines = 0;
+}
+
+// ============================================================
+// MAIN EDITOR LOOP
+// ============================================================
+void app_editor_run(void) {
+    // Initialize buffer
+    if (!ed_line_cache) ed_line_cache = kmem_cache_create("editor-line", ED_COLS + 1);
+    if (!ed_line_cache) return;
+    kmemset(ed_line_len, 0, sizeof(ed_line_len));
+    ed_total_lines = 0;
+    ed_cur_row = ed_cur_col = ed_scroll = 0;
+    ed_modified = false;
+
+    // Insert welcome text
+    static const char *welcome[] = {
+        "Welcome to ArcticOS Editor!",
+        "",
+        "Keyboard shortcuts:",
+        "  Arrow keys - move cursor",
+        "  Home/End   - start/end of line",
+        "  PgUp/PgDn  - page up/down",
+        "  ESC        - return to desktop",
+        "",
+        "Start typing below...",
+        "",
+    };
+    for (int i = 0; i < (int)(sizeof(welcome) / sizeof(welcome[0])); i++) {
+        if (!(ed_lines[i] = kmem_cache_alloc(ed_line_cache))) break;
+        kstrcpy(ed_lines[i], welcome[i]);
+        ed_line_len[i] = kstrlen(welcome[i]);
+        ed_total_lines++;
+    }
+    if (ed_total_lines == 0) return;
+
+    // Window
+    ed_win = wm_open(20, 20, fb.width - 40, fb.height - 60, "Text Editor - ArcticOS", ed_paint);
+    if (!ed_win) {
+        ed_free_lines();
+        return;
+    }
 
     // Main loop
     while (1) {
         // Refresh current row (cursor)
+        wm_begin(ed_win);
         ed_render_line(ed_cur_row);
         ed_update_status();
+        wm_end();
+        fb_present();
 
         char c = keyboard_getchar();
+        wm_begin(ed_win);
 
-        if (c == 27) break; // ESC
+        if (c == 27) { wm_end(); break; } // ESC
 
         // Navigation
         else if (c == 0) {
@@ -249,5 +272,8 @@ void app_editor_run(void) {
             ed_render_line(ed_cur_row);
             ed_ensure_visible();
         }
+        wm_end();
     }
+    wm_close(ed_win);
+    ed_free_lines();
 }
@@ -6,6 +6,7 @@
 #define CHAR_W      8
 #define CHAR_H      16
 #define INPUT_MAX   128
+#define TERM_BG     0x00050F18
 
 typedef struct {
     char  ch;
@@ -13,46 +14,88 @@ typedef struct {
     u32   bg;
 } term_cell_t;
 
-static term_cell_t term_buf[TERM_ROWS][TERM_COLS];
+// Lines form a ring: scrolling moves term_top instead of the cells.
+// The cells live in the app arena while the terminal is open.
+static term_cell_t (*term_buf)[TERM_COLS];
+static int term_top = 0;        // ring index of screen row 0
+static int term_pending = 0;    // scrolls not yet applied on screen
 static int cur_col = 0;
 static int cur_row = 0;
 static int term_ox, term_oy;  // pixel offset on screen
+static wm_window_t *term_win;
+
+static term_cell_t *term_line(int row) {
+    return term_buf[(term_top + row) % TERM_ROWS];
+}
+
+static void term_blank_line(term_cell_t *line) {
+    for (int c = 0; c < TERM_COLS; c++) {
+        line[c].ch = ' ';
+        line[c].fg = COLOR_TEXT_BRIGHT;
+        line[c].bg = TERM_BG;
+    }
+}
 
 static void term_clear(void) {
     for (int r = 0; r < TERM_ROWS; r++)
-        for (int c = 0; c < TERM_COLS; c++) {
-            term_buf[r][c].ch = ' ';
-            term_buf[r][c].fg = COLOR_TEXT_BRIGHT;
-            term_buf[r][c].bg = 0x00050F18;
-        }
+        term_blank_line(term_buf[r]);
+    term_top = term_pending = 0;
     cur_col = cur_row = 0;
 }
 
 static void term_render_cell(int row, int col) {
+    if (term_pending) return;   // term_flush() repaints the row
     int px = term_ox + col * CHAR_W;
     int py = term_oy + row * CHAR_H;
-    fb_draw_char(px, py, term_buf[row][col].ch,
-        term_buf[row][col].fg, term_buf[row][col].bg, 1);
+    term_cell_t *cell = &term_line(row)[col];
+    fb_draw_char(px, py, cell->ch, cell->fg, cell->bg, 1);
+}
+
+// One string per run of equally colored cells
+static void term_render_row(int row) {
+    term_cell_t *line = term_line(row);
+    char run[TERM_COLS + 1];
+    for (int c = 0; c < TERM_COLS; ) {
+        int start = c, n = 0;
+        while (c < TERM_COLS && line[c].fg == line[start].fg && line[c].bg == line[start].bg)
+            run[n++] = line[c++].ch;
+        run[n] = '\0';
+        fb_draw_string(term_ox + start * CHAR_W, term_oy + row * CHAR_H, run,
+            line[start].fg, line[start].bg, 1);
+    }
 }
 
 static void term_render_all(void) {
+    term_pending = 0;
     for (int r = 0; r < TERM_ROWS; r++)
-        for (int c = 0; c < TERM_COLS; c++)
-            term_render_cell(r, c);
+        term_render_row(r);
 }
 
+// Only rotates the ring; the pixels move in term_flush(), once
+// for all lines scrolled since the last flush
 static void term_scroll(void) {
-    for (int r = 0; r < TERM_ROWS - 1; r++)
-        for (int c = 0; c < TERM_COLS; c++)
-            term_buf[r][c] = term_buf[r+1][c];
-    for (int c = 0; c < TERM_COLS; c++) {
-        term_buf[TERM_ROWS-1][c].ch = ' ';
-        term_buf[TERM_ROWS-1][c].fg = COLOR_TEXT_BRIGHT;
-        term_buf[TERM_ROWS-1][c].bg = 0x00050F18;
-    }
+    term_top = (term_top + 1) % TERM_ROWS;
+    term_blank_line(term_line(TERM_ROWS - 1));
+    if (term_pending < TERM_ROWS) term_pending++;
     cur_row = TERM_ROWS - 1;
     cur_col = 0;
-    term_render_all();
+}
+
+// Bring the screen up to date: shift the rendered rows up by the
+// pending scroll and draw only the lines that came in at the bottom
+static void term_flush(void) {
+    int n = term_pending;
+    if (n == 0) return;
+    // Scrolling moves pixels, so the whole text area must be ours
+    fb_rect_t text = { term_ox, term_oy, TERM_COLS * CHAR_W, TERM_ROWS * CHAR_H };
+    if (n >= TERM_ROWS || !wm_visible(term_win, &text)) {
+        term_render_all();
+        return;
+    }
+    term_pending = 0;
+    fb_scroll_rect(term_ox, term_oy, TERM_COLS * CHAR_W, TERM_ROWS * CHAR_H, -n * CHAR_H);
+    for (int r = TERM_ROWS - n; r < TERM_ROWS; r++)
+        term_render_row(r);
 }
 
 static void term_newline(void) {
@@ -70,8 +113,8 @@ static void term_putchar(char c, u32 fg) {
         return;
     }
     if (cur_col >= TERM_COLS) term_newline();
-    term_buf[cur_row][cur_col].ch = c;
-    term_buf[cur_row][cur_col].fg = fg;
+    term_line(cur_row)[cur_col].ch = c;
+    term_line(cur_row)[cur_col].fg = fg;
     term_render_cell(cur_row, cur_col);
     cur_col++;
 }
@@ -92,16 +135,20 @@ static int term_readline(char *buf, int max) {
     int save_col = cur_col;
 
     while (1) {
+        term_flush();
+
         // Draw cursor
         int px = term_ox + cur_col * CHAR_W;
         int py = term_oy + cur_row * CHAR_H;
         fb_fill_rect(px, py + CHAR_H - 2, CHAR_W, 2, COLOR_ARCTIC_ACC);
+        wm_end();
+        fb_present();
 
         char c = keyboard_getchar();
+        wm_begin(term_win);
 
         // Erase cursor
-        fb_fill_rect(px, py + CHAR_H - 2, CHAR_W, 2,
-            term_buf[cur_row][cur_col].bg);
+        fb_fill_rect(px, py + CHAR_H - 2, CHAR_W, 2, TERM_BG);
 
         if (c == '\n' || c == '\r') {
             buf[len] = '\0';
@@ -112,7 +159,7 @@ static int term_readline(char *buf, int max) {
                 len--;
                 cur_col--;
                 if (cur_col < 0) cur_col = 0;
-                term_buf[cur_row][cur_col].ch = ' ';
+                term_line(cur_row)[cur_col].ch = ' ';
                 term_render_cell(cur_row, cur_col);
             }
         } else if (c == 0x03) { // Ctrl+C
@@ -143,6 +190,13 @@ static void cmd_help(void) {
     term_puts_ln("  cpuid    - CPU info", COLOR_TEXT_BRIGHT);
     term_puts_ln("  uptime   - system uptime", COLOR_TEXT_BRIGHT);
     term_puts_ln("  color    - color test", COLOR_TEXT_BRIGHT);
+    term_puts_ln("  mode     - show/set video mode (mode 1024x768x32)", COLOR_TEXT_BRIGHT);
+    term_puts_ln("  frames   - frame scheduler statistics", COLOR_TEXT_BRIGHT);
+    term_puts_ln("  slabinfo - kernel allocator caches", COLOR_TEXT_BRIGHT);
+    term_puts_ln("  membench - memcpy/memset throughput", COLOR_TEXT_BRIGHT);
+    term_puts_ln("  bench    - microbenchmarks, cycles (bench [name prefix])", COLOR_TEXT_BRIGHT);
+    term_puts_ln("  prof     - profiler (prof start [hz] [stacks]|stop|dump)", COLOR_TEXT_BRIGHT);
+    term_puts_ln("  trace    - event trace (trace start|stop|dump)", COLOR_TEXT_BRIGHT);
     term_puts_ln("  exit     - return to desktop", COLOR_TEXT_BRIGHT);
     term_puts_ln("", 0);
 }
@@ -177,17 +231,39 @@ static void cmd_meminfo(void) {
     term_puts_ln(buf, COLOR_TEXT_BRIGHT);
     ksprintf(buf, "Pitch: %u bytes", fb.pitch);
     term_puts_ln(buf, COLOR_TEXT_BRIGHT);
-    term_puts_ln("RAM: detected by GRUB (no MMU)", COLOR_LIGHT_GRAY);
+    ksprintf(buf, "FB caching: %s", fb_cache_mode());
+    term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+    ksprintf(buf, "VRAM write: %u MB/s", fb_measure_bandwidth());
+    term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+    pmm_stats_t pm;
+    pmm_get_stats(&pm);
+    ksprintf(buf, "RAM: %u MiB usable, %u MiB free",
+        pm.usable_pages / 256, pm.free_pages / 256);
+    term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+    ksprintf(buf, "Kernel image: %u KiB", pm.kernel_bytes / 1024);
+    term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+    term_puts("Free blocks:", COLOR_LIGHT_GRAY);
+    for (int k = 0; k <= PMM_MAX_ORDER; k++) {
+        ksprintf(buf, " %u", pm.free_blocks[k]);
+        term_puts(buf, COLOR_LIGHT_GRAY);
+    }
+    term_puts_ln(" (4K..4M)", COLOR_LIGHT_GRAY);
+    ksprintf(buf, "Arenas: app %u KiB used / %u KiB, scratch %u KiB",
+        app_arena.used / 1024, app_arena.pages * 4, frame_scratch.pages * 4);
+    term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+    if (cpu_paging_enabled()) {
+        paging_stats_t pg;
+        paging_get_stats(&pg);
+        ksprintf(buf, "Paging: %u x 4M, %u x 4K pages (%u tables)",
+            pg.large_pages, pg.small_pages, pg.tables);
+        term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+    }
 }
 
 static void cmd_cpuid(void) {
     u32 eax, ebx, ecx, edx;
     char vendor[13];
-    __asm__ volatile (
-        "cpuid"
-        : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
-        : "a"(0)
-    );
+    cpu_cpuid(0, &eax, &ebx, &ecx, &edx);
     *(u32*)(vendor)     = ebx;
     *(u32*)(vendor + 4) = edx;
     *(u32*)(vendor + 8) = ecx;
@@ -195,28 +271,189 @@ static void cmd_cpuid(void) {
     char buf[64];
     ksprintf(buf, "Vendor: %s", vendor);
     term_puts_ln(buf, COLOR_TEXT_BRIGHT);
-    __asm__ volatile (
-        "cpuid"
-        : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
-        : "a"(1)
-    );
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
     ksprintf(buf, "Model: family=%u model=%u stepping=%u",
         (eax >> 8) & 0xF, (eax >> 4) & 0xF, eax & 0xF);
     term_puts_ln(buf, COLOR_TEXT_BRIGHT);
-    ksprintf(buf, "Features: %s %s %s",
-        (edx >> 4) & 1 ? "TSC" : "",
-        (edx >> 23) & 1 ? "MMX" : "",
-        (edx >> 25) & 1 ? "SSE" : "");
+    ksprintf(buf, "Features: %s %s %s %s %s",
+        (edx >> CPUID_EDX_TSC)  & 1 ? "TSC"  : "",
+        (edx >> CPUID_EDX_MMX)  & 1 ? "MMX"  : "",
+        (edx >> CPUID_EDX_SSE)  & 1 ? "SSE"  : "",
+        (edx >> CPUID_EDX_MTRR) & 1 ? "MTRR" : "",
+        (edx >> CPUID_EDX_PAT)  & 1 ? "PAT"  : "");
+    term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+    ksprintf(buf, "Blit kernels: %s", blit_impl_name());
     term_puts_ln(buf, COLOR_TEXT_BRIGHT);
 }
 
 static void cmd_uptime(void) {
-    u32 ticks = timer_get_ticks();
-    u32 secs  = ticks / 100;
-    u32 mins  = secs / 60;
-    u32 hrs   = mins / 60;
+    u32 ns;
+    u32 secs = (u32)kdiv64(ktime_ns(), 1000000000, &ns);
+    u32 mins = secs / 60;
+    u32 hrs  = mins / 60;
     char buf[64];
-    ksprintf(buf, "Uptime: %u hrs %u min %u sec", hrs, mins % 60, secs % 60);
+    ksprintf(buf, "Uptime: %u hrs %u min %u.%03u sec", hrs, mins % 60, secs % 60, ns / 1000000);
+    term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+    ksprintf(buf, "Clocksource: %s, %u kHz", clocksource_name(), clocksource_khz());
+    term_puts_ln(buf, COLOR_LIGHT_GRAY);
+    ksprintf(buf, "Timer: %s, %u interrupts",
+        timer_is_oneshot() ? "one-shot (tickless)" : "periodic", timer_get_ticks());
+    term_puts_ln(buf, COLOR_LIGHT_GRAY);
+}
+
+static void cmd_frames(void) {
+    frame_stats_t st;
+    frame_get_stats(&st);
+    char buf[64];
+    ksprintf(buf, "Rate: %u Hz, budget %u us", st.hz, st.budget_us);
+    term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+    ksprintf(buf, "Frames: %u run, %u idle, %u dropped", st.frames, st.idle, st.dropped);
+    term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+    ksprintf(buf, "CPU: last %u us, max %u us, %u over budget",
+        st.last_us, st.max_us, st.over_budget);
+    term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+}
+
+// One line per object cache: object size, objects in use / room in
+// its slabs, slab pages, and lifetime alloc/free counts
+static void cmd_slabinfo(void) {
+    char buf[80];
+    term_puts_ln("cache          size  active/total  pages  allocs/frees", COLOR_YELLOW);
+    kmem_stats_t st;
+    for (int i = 0; kmem_cache_stats(i, &st); i++) {
+        int n = kstrlen(st.name);
+        kmemcpy(buf, st.name, n);
+        while (n < 14) buf[n++] = ' ';
+        ksprintf(buf + n, " %u  %u/%u  %u  %u/%u",
+            st.size, st.active, st.total, st.pages, st.allocs, st.frees);
+        term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+    }
+}
+
+static void term_bench_line(const char *line) {
+    term_puts_ln(line, COLOR_TEXT_BRIGHT);
+}
+
+static void cmd_membench(void) {
+    term_puts_ln("Measuring copy/fill throughput...", COLOR_LIGHT_GRAY);
+    bench_memory(term_bench_line);
+}
+
+// One pass of the terminal's own scroll path, for `bench`
+static void term_bench_scroll(u32 arg) {
+    (void)arg;
+    term_scroll();
+    term_flush();
+}
+
+#define BENCH_LINES 32
+static const char *bench_lines[BENCH_LINES];
+static int bench_nlines;
+
+static void term_bench_keep(const char *line) {
+    if (bench_nlines == BENCH_LINES) return;
+    char *copy = arena_alloc(&app_arena, (u32)kstrlen(line) + 1);
+    if (!copy) return;
+    kstrcpy(copy, line);
+    bench_lines[bench_nlines++] = copy;
+}
+
+// bench [name prefix]: the suite draws all over the screen, so it
+// runs outside the window session; results are printed after the
+// repaint. term_scroll blanks lines, so the text and cursor are
+// saved around the run.
+static void cmd_bench(const char *filter) {
+    u32 cells = sizeof(term_cell_t) * TERM_ROWS * TERM_COLS;
+    term_cell_t *saved = kmalloc(cells);
+    if (!saved) {
+        term_puts_ln("Cannot run: out of memory", 0x00FF4444);
+        return;
+    }
+    term_puts_ln("Running benchmarks...", COLOR_LIGHT_GRAY);
+    kmemcpy(saved, term_buf, cells);
+    int top = term_top, row = cur_row, col = cur_col;
+    wm_end();
+    fb_present();
+    bench_nlines = 0;
+    bench_run(filter, term_bench_keep);
+    kmemcpy(term_buf, saved, cells);
+    kfree(saved);
+    term_top = top;
+    cur_row = row;
+    cur_col = col;
+    term_pending = 0;   // the repaint below draws every row
+    wm_repaint(NULL);
+    wm_begin(term_win);
+    for (int i = 0; i < bench_nlines; i++)
+        term_puts_ln(bench_lines[i], COLOR_TEXT_BRIGHT);
+}
+
+// prof [start [hz] [stacks] | stop | dump]
+static void cmd_prof(const char *arg) {
+    char buf[80];
+    if (kstrncmp(arg, "start", 5) == 0) {
+        arg += 5;
+        while (*arg == ' ') arg++;
+        u32 hz = (u32)katoi(arg);
+        while (*arg >= '0' && *arg <= '9') arg++;
+        while (*arg == ' ') arg++;
+        bool stacks = kstrcmp(arg, "stacks") == 0;
+        hz = prof_start(hz, stacks);
+        if (!hz) {
+            term_puts_ln("Cannot start: already running or out of memory", 0x00FF4444);
+            return;
+        }
+        ksprintf(buf, "Sampling at %u Hz%s", hz, stacks ? " with call stacks" : "");
+        term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+        return;
+    }
+    if (kstrcmp(arg, "stop") == 0) {
+        prof_stop();
+    } else if (kstrcmp(arg, "dump") == 0) {
+        if (!prof_dump()) {
+            term_puts_ln("Nothing sent: no profile or no serial port", 0x00FF4444);
+            return;
+        }
+        term_puts_ln("Profile sent to COM1 (tools/profsym.py)", COLOR_TEXT_BRIGHT);
+    } else if (*arg) {
+        term_puts_ln("Usage: prof [start [hz] [stacks] | stop | dump]", 0x00FF4444);
+        return;
+    }
+    prof_stats_t st;
+    prof_get_stats(&st);
+    ksprintf(buf, "Profiler: %s, %u Hz, %u samples (%u outside kernel text)",
+        st.running ? "running" : "stopped", st.hz, st.samples, st.outside);
+    term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+    if (st.stacks_on) {
+        ksprintf(buf, "Stacks: %u kept, %u dropped", st.stacks, st.dropped);
+        term_puts_ln(buf, COLOR_LIGHT_GRAY);
+    }
+}
+
+// trace [start | stop | dump]
+static void cmd_trace(const char *arg) {
+    if (kstrcmp(arg, "start") == 0) {
+        if (!trace_start()) {
+            term_puts_ln("Cannot start: needs a calibrated TSC and 256 KiB", 0x00FF4444);
+            return;
+        }
+    } else if (kstrcmp(arg, "stop") == 0) {
+        trace_stop();
+    } else if (kstrcmp(arg, "dump") == 0) {
+        if (!trace_dump()) {
+            term_puts_ln("Nothing sent: no trace or no serial port", 0x00FF4444);
+            return;
+        }
+        term_puts_ln("Trace sent to COM1 (tools/trace2json.py)", COLOR_TEXT_BRIGHT);
+    } else if (*arg) {
+        term_puts_ln("Usage: trace [start | stop | dump]", 0x00FF4444);
+        return;
+    }
+    trace_stats_t st;
+    trace_get_stats(&st);
+    char buf[80];
+    ksprintf(buf, "Trace: %s, %u events held, %u overwritten",
+        st.running ? "recording" : "stopped", st.events, st.lost);
     term_puts_ln(buf, COLOR_TEXT_BRIGHT);
 }
 
@@ -232,26 +469,71 @@ static void cmd_color(void) {
     }
 }
 
+// mode            - show the current mode
+// mode WxHxBPP    - switch (Bochs/QEMU -vga std adapter only)
+static void cmd_mode(const char *arg) {
+    char buf[64];
+    if (*arg == '\0') {
+        ksprintf(buf, "Mode: %ux%ux%u, %s", fb.width, fb.height, (u32)fb.bpp,
+            fb_flipping() ? "page flipping" : "single buffer");
+        term_puts_ln(buf, COLOR_TEXT_BRIGHT);
+        return;
+    }
+    if (!bga_present()) {
+        term_puts_ln("Mode switching needs the BGA adapter (qemu -vga std)", 0x00FF4444);
+        return;
+    }
+    u32 v[3] = { 0, 0, 32 };
+    for (int i = 0; i < 3 && *arg; i++) {
+        v[i] = (u32)katoi(arg);
+        while (*arg >= '0' && *arg <= '9') arg++;
+        if (*arg == 'x' || *arg == ' ') arg++;
+    }
+    wm_end();
+    bool ok = bga_set_mode(v[0], v[1], v[2]);
+    if (ok) {
+        // Every pixel is stale: fit the window, repaint the screen
+        fb_rect_t frame = { 40, 20, (int)fb.width - 80, (int)fb.height - 70 };
+        term_win->frame = frame;
+        wm_repaint(NULL);
+    }
+    wm_begin(term_win);
+    if (!ok) {
+        ksprintf(buf, "Cannot set %ux%ux%u", v[0], v[1], v[2]);
+        term_puts_ln(buf, 0x00FF4444);
+        return;
+    }
+    ksprintf(buf, "Mode: %ux%ux%u", fb.width, fb.height, (u32)fb.bpp);
+    term_puts_ln(buf, COLOR_GREEN);
+}
+
 // ============================================================
 // MAIN TERMINAL LOOP
 // ============================================================
-void app_terminal_run(void) {
-    // Window
-    int win_x = 40, win_y = 20;
-    int win_w = fb.width - 80;
-    int win_h = fb.height - 70;
+static void term_paint(wm_window_t *w) {
+    int win_x = w->frame.x, win_y = w->frame.y;
+    int win_w = w->frame.w, win_h = w->frame.h;
 
-    fb_fill_rect(win_x, win_y, win_w, win_h, 0x00050F18);
+    fb_fill_rect(win_x, win_y, win_w, win_h, TERM_BG);
     fb_draw_rect(win_x, win_y, win_w, win_h, COLOR_ARCTIC_ACC, 2);
     fb_fill_rect(win_x, win_y, win_w, 26, COLOR_ARCTIC_BAR);
-    fb_draw_string(win_x + 10, win_y + 6, "Terminal - ArcticOS Shell", COLOR_ARCTIC_ACC, COLOR_ARCTIC_BAR, 1);
+    fb_draw_string(win_x + 10, win_y + 6, w->title, COLOR_ARCTIC_ACC, COLOR_ARCTIC_BAR, 1);
     fb_draw_string(win_x + win_w - 64, win_y + 6, "[exit]=Quit", COLOR_LIGHT_GRAY, COLOR_ARCTIC_BAR, 1);
 
     term_ox = win_x + 4;
     term_oy = win_y + 30;
+    term_render_all();
+}
 
+void app_terminal_run(void) {
+    term_buf = arena_alloc(&app_arena, sizeof(term_cell_t) * TERM_ROWS * TERM_COLS);
+    if (!term_buf) return;
     term_clear();
-    term_render_all();
+    term_win = wm_open(40, 20, fb.width - 80, fb.height - 70,
+                       "Terminal - ArcticOS Shell", term_paint);
+    if (!term_win) return;
+    wm_begin(term_win);
+    int scroll_bench = bench_add("term_scroll", term_bench_scroll, 0);
 
     // Welcome message
     term_puts_ln("ArcticOS Shell v1.0 - Type 'help' to see commands", COLOR_ARCTIC_ACC);
@@ -285,8 +567,22 @@ void app_terminal_run(void) {
             cmd_cpuid();
         } else if (kstrcmp(input, "uptime") == 0) {
             cmd_uptime();
+        } else if (kstrcmp(input, "frames") == 0) {
+            cmd_frames();
+        } else if (kstrcmp(input, "slabinfo") == 0) {
+            cmd_slabinfo();
+        } else if (kstrcmp(input, "membench") == 0) {
+            cmd_membench();
+        } else if (kstrcmp(input, "bench") == 0 || kstrncmp(input, "bench ", 6) == 0) {
+            cmd_bench(input[5] ? input + 6 : "");
+        } else if (kstrcmp(input, "prof") == 0 || kstrncmp(input, "prof ", 5) == 0) {
+            cmd_prof(input[4] ? input + 5 : "");
+        } else if (kstrcmp(input, "trace") == 0 || kstrncmp(input, "trace ", 6) == 0) {
+            cmd_trace(input[5] ? input + 6 : "");
         } else if (kstrcmp(input, "color") == 0) {
             cmd_color();
+        } else if (kstrcmp(input, "mode") == 0 || kstrncmp(input, "mode ", 5) == 0) {
+            cmd_mode(input[4] ? input + 5 : "");
         } else if (kstrcmp(input, "exit") == 0 || kstrcmp(input, "quit") == 0) {
             break;
         } else if (kstrncmp(input, "echo ", 5) == 0) {
@@ -297,4 +593,7 @@ void app_terminal_run(void) {
             term_puts_ln(err, 0x00FF4444);
         }
     }
+    bench_remove(scroll_bench);
+    wm_end();
+    wm_close(term_win);
 }
@@ -102,6 +102,19 @@ inw:
     in ax, dx
     ret
 
+global outl
+outl:
+    mov dx, [esp+4]
+    mov eax, [esp+8]
+    out dx, eax
+    ret
+
+global inl
+inl:
+    mov dx, [esp+4]
+    in eax, dx
+    ret
+
 global enable_interrupts
 enable_interrupts:
     sti
@@ -132,14 +145,35 @@ gdt_load:
 .flush:
     ret
 
+; IRQ stubs preserve the FPU/SSE state (fxsave into a 16-byte aligned
+; 512-byte area on the stack) once cpu_enable_sse() has turned it on,
+; so handlers may use the SSE blit kernels without corrupting the
+; interrupted code. ebp keeps pointing at the pusha frame, which is
+; also passed to irq_handler (with the CPU's eip/cs/eflags above it).
+extern cpu_fxsave_enabled
+
 %macro IRQ_STUB 1
 global irq%1_handler_asm
 irq%1_handler_asm:
     pusha
+    mov ebp, esp
+    cld
+    cmp byte [cpu_fxsave_enabled], 0
+    je %%no_save
+    sub esp, 512
+    and esp, 0xFFFFFFF0
+    fxsave [esp]
+%%no_save:
+    push ebp
     push dword %1
     extern irq_handler
     call irq_handler
-    add esp, 4
+    add esp, 8
+    cmp byte [cpu_fxsave_enabled], 0
+    je %%no_restore
+    fxrstor [esp]
+%%no_restore:
+    mov esp, ebp
     popa
     iret
 %endmacro
@@ -172,9 +206,4 @@ ISR_STUB 8
 ISR_STUB 13
 ISR_STUB 14
 
-global rdtsc_low
-rdtsc_low:
-    rdtsc
-    ret
-
 section .note.GNU-stack noalloc noexec nowrite progbits
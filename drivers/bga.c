@@ -0,0 +1,127 @@
+#include "../include/kernel.h"
+
+// Bochs Graphics Adapter: the DISPI registers behind QEMU's -vga std
+// (and Bochs' own VBE). Modes are set with a virtual height of two
+// screens so fb_present() can flip pages with a Y offset write.
+
+#define BGA_INDEX_PORT      0x01CE
+#define BGA_DATA_PORT       0x01CF
+
+#define BGA_REG_ID          0x00
+#define BGA_REG_XRES        0x01
+#define BGA_REG_YRES        0x02
+#define BGA_REG_BPP         0x03
+#define BGA_REG_ENABLE      0x04
+#define BGA_REG_VIRT_WIDTH  0x06
+#define BGA_REG_VIRT_HEIGHT 0x07
+#define BGA_REG_X_OFFSET    0x08
+#define BGA_REG_Y_OFFSET    0x09
+#define BGA_REG_VIDEO_MEM   0x0A    // VRAM size in 64 KiB units
+
+#define BGA_ID_MIN          0xB0C0
+#define BGA_ID_MAX          0xB0CF
+#define BGA_DISABLED        0x00
+#define BGA_ENABLED         0x01
+#define BGA_LFB_ENABLED     0x40
+
+#define BGA_MAX_XRES        2560
+#define BGA_MAX_YRES        1600
+#define BGA_LFB_DEFAULT     0xE0000000  // Bochs ISA default if PCI has no BAR
+
+#define PCI_CONFIG_ADDR     0x0CF8
+#define PCI_CONFIG_DATA     0x0CFC
+
+static u32 *bga_lfb = 0;
+static u32  bga_vram = 0;
+
+static void bga_write(u16 reg, u16 val) {
+    outw(BGA_INDEX_PORT, reg);
+    outw(BGA_DATA_PORT, val);
+}
+
+static u16 bga_read(u16 reg) {
+    outw(BGA_INDEX_PORT, reg);
+    return inw(BGA_DATA_PORT);
+}
+
+static u32 pci_read(u32 bus, u32 slot, u32 func, u32 off) {
+    outl(PCI_CONFIG_ADDR, 0x80000000 | (bus << 16) | (slot << 11) | (func << 8) | (off & 0xFC));
+    return inl(PCI_CONFIG_DATA);
+}
+
+// LFB address from BAR0 of the display device on bus 0
+static u32 bga_find_lfb(void) {
+    for (u32 slot = 0; slot < 32; slot++) {
+        u32 id = pci_read(0, slot, 0, 0x00);
+        if (id == 0x11111234 ||     // QEMU/Bochs stdvga
+            id == 0xBEEF80EE) {     // VirtualBox VGA (same registers)
+            u32 bar0 = pci_read(0, slot, 0, 0x10);
+            if (bar0 & ~0xFu) return bar0 & ~0xFu;
+        }
+    }
+    return 0;
+}
+
+bool bga_present(void) {
+    u16 id = bga_read(BGA_REG_ID);
+    return id >= BGA_ID_MIN && id <= BGA_ID_MAX;
+}
+
+static void bga_show_page(int page) {
+    bga_write(BGA_REG_Y_OFFSET, (u16)(page * fb.height));
+}
+
+// Program a mode and hand it to the framebuffer layer, double
+// buffered when VRAM holds two pages. The caller redraws.
+bool bga_set_mode(u32 width, u32 height, u32 bpp) {
+    if (!bga_lfb) return false;
+    if (bpp != 16 && bpp != 24 && bpp != 32) return false;
+    if (width < 320 || height < 200 || width > BGA_MAX_XRES || height > BGA_MAX_YRES)
+        return false;
+    u32 pitch = width * (bpp / 8);
+    if (pitch * height > bga_vram) return false;
+    u32 virt_h = pitch * height * 2 <= bga_vram ? height * 2 : height;
+
+    bga_write(BGA_REG_ENABLE, BGA_DISABLED);
+    bga_write(BGA_REG_XRES, (u16)width);
+    bga_write(BGA_REG_YRES, (u16)height);
+    bga_write(BGA_REG_BPP, (u16)bpp);
+    bga_write(BGA_REG_VIRT_WIDTH, (u16)width);
+    bga_write(BGA_REG_VIRT_HEIGHT, (u16)virt_h);
+    bga_write(BGA_REG_ENABLE, BGA_ENABLED | BGA_LFB_ENABLED);
+    bga_write(BGA_REG_X_OFFSET, 0);
+    bga_write(BGA_REG_Y_OFFSET, 0);
+
+    if (bga_read(BGA_REG_XRES) != width || bga_read(BGA_REG_YRES) != height ||
+        bga_read(BGA_REG_BPP) != bpp) {
+        // Refused: put the previous mode back (its back buffer is intact)
+        if (fb.addr == bga_lfb && (fb.width != width || fb.height != height || fb.bpp != bpp))
+            bga_set_mode(fb.width, fb.height, fb.bpp);
+        return false;
+    }
+
+    fb.vram_size = bga_vram;
+    fb_set_mode(bga_lfb, width, height, pitch, (u8)bpp);
+    if (bga_read(BGA_REG_VIRT_HEIGHT) >= height * 2)
+        fb_enable_flip(bga_show_page);
+    return true;
+}
+
+// Take over the display if it is a BGA: keep the mode GRUB set (or
+// 800x600x32 when booted without one) but with two pages.
+bool bga_init(void) {
+    if (!bga_present()) return false;
+
+    u32 lfb = bga_find_lfb();
+    if (!lfb) lfb = fb.addr ? (u32)fb.addr : BGA_LFB_DEFAULT;
+    bga_lfb  = (u32 *)lfb;
+    bga_vram = (u32)bga_read(BGA_REG_VIDEO_MEM) * 64 * 1024;
+    if (bga_vram == 0) bga_vram = 4 * 1024 * 1024;     // pre-0xB0C4 devices
+
+    u32 w = fb.width, h = fb.height, bpp = fb.bpp;
+    if (!fb.addr || (bpp != 16 && bpp != 24 && bpp != 32) ||
+        w < 320 || h < 200 || w > BGA_MAX_XRES || h > BGA_MAX_YRES) {
+        w = 800; h = 600; bpp = 32;
+    }
+    return bga_set_mode(w, h, bpp);
+}
@@ -109,6 +109,524 @@ static const u8 font8x8[128][8] = {
     ['~'] = {0x6E,0x3B,0x00,0x00,0x00,0x00,0x00,0x00},
 };
 
+// ============================================================
+// SPAN ENGINE
+// Every fill goes through one row writer chosen for the current
+// pixel format, so the bpp branch and color packing happen once
+// per primitive instead of once per pixel.
+// ============================================================
+typedef void (*fb_span_fn)(u8 *row, int w, u32 px);
+
+static u32 pack_rgb888(u32 color) {
+    return color;
+}
+
+static u32 pack_rgb565(u32 color) {
+    u32 r5 = (color >> 19) & 0x1F;
+    u32 g6 = (color >> 10) & 0x3F;
+    u32 b5 = (color >>  3) & 0x1F;
+    return (r5 << 11) | (g6 << 5) | b5;
+}
+
+// Alpha 0xFF = opaque, so plain colors come out solid and
+// COLOR_TRANSPARENT (0xFF000000) becomes fully transparent
+static u32 pack_argb8888(u32 color) {
+    return color ^ 0xFF000000;
+}
+
+static u32 fb_format_bytes(u32 format) {
+    switch (format) {
+        case FB_FORMAT_RGB565:   return 2;
+        case FB_FORMAT_RGB888:   return 3;
+        case FB_FORMAT_XRGB8888:
+        case FB_FORMAT_ARGB8888: return 4;
+    }
+    return 0;
+}
+
+// Read a pixel as 0xAARRGGBB; formats without alpha read as opaque
+static inline u32 px_read(const u8 *p, u32 format) {
+    switch (format) {
+        case FB_FORMAT_ARGB8888: return *(const u32 *)p;
+        case FB_FORMAT_XRGB8888: return *(const u32 *)p | 0xFF000000;
+        case FB_FORMAT_RGB888:   return p[0] | (p[1] << 8) | ((u32)p[2] << 16) | 0xFF000000;
+        case FB_FORMAT_RGB565: {
+            u32 v = *(const u16 *)p;
+            u32 r = (v >> 11) & 0x1F, g = (v >> 5) & 0x3F, b = v & 0x1F;
+            return 0xFF000000 | ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+        }
+    }
+    return 0;
+}
+
+static inline void px_write(u8 *p, u32 format, u32 argb) {
+    switch (format) {
+        case FB_FORMAT_ARGB8888:
+        case FB_FORMAT_XRGB8888: *(u32 *)p = argb; break;
+        case FB_FORMAT_RGB888:   p[0] = (u8)argb; p[1] = (u8)(argb >> 8); p[2] = (u8)(argb >> 16); break;
+        case FB_FORMAT_RGB565:   *(u16 *)p = (u16)pack_rgb565(argb); break;
+    }
+}
+
+static void span32(u8 *row, int w, u32 px) {
+    if (w >= 16) {
+        blit_fill32(row, px, (size_t)w);
+        return;
+    }
+    u32 *p = (u32 *)row;
+    while (w--) *p++ = px;
+}
+
+static void span24(u8 *row, int w, u32 px) {
+    u8 b = (u8)px, g = (u8)(px >> 8), r = (u8)(px >> 16);
+    // 4 pixels = 12 bytes = 3 dwords (little endian: B G R B | G R B G | R B G R)
+    u32 d0 = b | (g << 8) | (r << 16) | ((u32)b << 24);
+    u32 d1 = g | (r << 8) | (b << 16) | ((u32)g << 24);
+    u32 d2 = r | (b << 8) | (g << 16) | ((u32)r << 24);
+    for (; w >= 4; w -= 4, row += 12) {
+        u32 *p = (u32 *)row;
+        p[0] = d0; p[1] = d1; p[2] = d2;
+    }
+    while (w--) {
+        row[0] = b; row[1] = g; row[2] = r;
+        row += 3;
+    }
+}
+
+static void span16(u8 *row, int w, u32 px) {
+    u16 *p = (u16 *)row;
+    if (w > 0 && ((u32)p & 2)) { *p++ = (u16)px; w--; }
+    u32 pair = (px & 0xFFFF) | (px << 16);
+    u32 *q = (u32 *)p;
+    if (w >= 32) {
+        blit_fill32(q, pair, (size_t)(w >> 1));
+        q += w >> 1;
+        w &= 1;
+    }
+    for (; w >= 2; w -= 2) *q++ = pair;
+    if (w) *(u16 *)q = (u16)px;
+}
+
+static void span_none(u8 *row, int w, u32 px) {
+    (void)row; (void)w; (void)px;   // unsupported mode - draw nothing
+}
+
+// ============================================================
+// DRAWING TARGET
+// Every primitive draws through a context: the target surface (the
+// screen's back buffer by default, or any surface handed to
+// fb_set_target()), the span/pack hooks for its pixel format, the
+// clip rect [clip_x0, clip_x1) x [clip_y0, clip_y1), which is the
+// whole target unless fb_set_clip() narrows it, and scratch space.
+// Only the screen records damage. Direct drawing goes through
+// fb_main; display list replay gives each renderer its own context.
+// fb_cx is the context in use on this CPU.
+// ============================================================
+#define CIRCLE_MAX_R 1024
+
+typedef struct {
+    fb_surface_t *target;
+    fb_span_fn    span;             // writes w pixels of packed color px
+    u32         (*pack)(u32 color);
+    u32           bytespp;
+    int clip_x0, clip_y0, clip_x1, clip_y1;
+    int hw_outer[CIRCLE_MAX_R + 1]; // circle half-widths per row
+    int hw_inner[CIRCLE_MAX_R + 1];
+} fb_ctx_t;
+
+static fb_surface_t  fb_screen;
+static fb_ctx_t      fb_main = { .target = &fb_screen };
+static fb_ctx_t     *fb_cx = &fb_main;
+
+static void fb_ctx_clip(fb_ctx_t *cx, const fb_rect_t *r) {
+    cx->clip_x0 = 0;
+    cx->clip_y0 = 0;
+    cx->clip_x1 = cx->target->width;
+    cx->clip_y1 = cx->target->height;
+    if (!r) return;
+    if (r->x > cx->clip_x0) cx->clip_x0 = r->x;
+    if (r->y > cx->clip_y0) cx->clip_y0 = r->y;
+    if (r->x + r->w < cx->clip_x1) cx->clip_x1 = r->x + r->w;
+    if (r->y + r->h < cx->clip_y1) cx->clip_y1 = r->y + r->h;
+    if (cx->clip_x1 < cx->clip_x0) cx->clip_x1 = cx->clip_x0;
+    if (cx->clip_y1 < cx->clip_y0) cx->clip_y1 = cx->clip_y0;
+}
+
+void fb_set_clip(const fb_rect_t *r) {
+    fb_ctx_clip(fb_cx, r);
+}
+
+static void fb_bind(fb_ctx_t *cx, fb_surface_t *s) {
+    cx->target = s;
+    fb_ctx_clip(cx, NULL);
+    cx->pack   = pack_rgb888;
+    switch (s->format) {
+        case FB_FORMAT_XRGB8888: cx->span = span32; break;
+        case FB_FORMAT_ARGB8888: cx->span = span32; cx->pack = pack_argb8888; break;
+        case FB_FORMAT_RGB888:   cx->span = span24; break;
+        case FB_FORMAT_RGB565:   cx->span = span16; cx->pack = pack_rgb565; break;
+        default:                 cx->span = span_none; break;
+    }
+    cx->bytespp = fb_format_bytes(s->format);
+}
+
+fb_surface_t *fb_set_target(fb_surface_t *s) {
+    fb_surface_t *prev = fb_cx->target;
+    fb_bind(fb_cx, s ? s : &fb_screen);
+    return prev;
+}
+
+void fb_surface_init(fb_surface_t *s, int w, int h, u32 format, void *pixels) {
+    s->width  = w;
+    s->height = h;
+    s->format = format;
+    s->pitch  = (u32)w * fb_format_bytes(format);
+    s->pixels = pixels;
+}
+
+u32 fb_surface_size(int w, int h, u32 format) {
+    return (u32)w * fb_format_bytes(format) * (u32)h;
+}
+
+// ============================================================
+// GLYPH CACHE
+// Glyphs are expanded once per (fg, bg, scale) into native pixels,
+// so opaque text is one row copy per glyph line. Transparent text
+// uses per-byte run tables (start, length of each lit stretch).
+// ============================================================
+#define GLYPH_FIRST     32
+#define GLYPH_COUNT     96      // printable ASCII 32..127
+#define GLYPH_SLOTS_S1  16      // color pairs cached at scale 1
+#define GLYPH_SLOTS_S2  4       // color pairs cached at scale 2
+
+typedef struct {
+    u32 fg, bg;
+    u32 stamp;                      // LRU age, 0 = free
+    u32 ready[GLYPH_COUNT / 32];    // one bit per glyph already expanded
+    u8 *pixels;
+} glyph_slot_t;
+
+static u8 glyph_px_s1[GLYPH_SLOTS_S1][GLYPH_COUNT * 8 * 8 * 4];
+static u8 glyph_px_s2[GLYPH_SLOTS_S2][GLYPH_COUNT * 16 * 16 * 4];
+static glyph_slot_t glyph_slots_s1[GLYPH_SLOTS_S1];
+static glyph_slot_t glyph_slots_s2[GLYPH_SLOTS_S2];
+static u32 glyph_clock = 0;
+
+// glyph_runs[b] = { count, start0, len0, start1, len1, ... } for bits of b
+static u8 glyph_runs[256][9];
+
+static void glyph_cache_reset(void) {
+    for (int i = 0; i < GLYPH_SLOTS_S1; i++) {
+        glyph_slots_s1[i].stamp  = 0;
+        glyph_slots_s1[i].pixels = glyph_px_s1[i];
+    }
+    for (int i = 0; i < GLYPH_SLOTS_S2; i++) {
+        glyph_slots_s2[i].stamp  = 0;
+        glyph_slots_s2[i].pixels = glyph_px_s2[i];
+    }
+    glyph_clock = 0;
+
+    for (int b = 0; b < 256; b++) {
+        u8 *r = glyph_runs[b];
+        r[0] = 0;
+        for (int col = 0; col < 8; ) {
+            if (!(b & (1 << col))) { col++; continue; }
+            int start = col;
+            while (col < 8 && (b & (1 << col))) col++;
+            r[1 + 2 * r[0]] = (u8)start;
+            r[2 + 2 * r[0]] = (u8)(col - start);
+            r[0]++;
+        }
+    }
+}
+
+// ============================================================
+// BACK BUFFER & DAMAGE LIST
+// Primitives draw into RAM and record what they touched;
+// fb_present() copies only those rectangles out to VRAM.
+// ============================================================
+#define FB_DAMAGE_MAX    32
+#define FB_DAMAGE_SLACK  4096   // extra pixels a merge may copy for nothing
+#define FB_STREAM_MIN    (256 * 1024)   // fills this big bypass the cache
+
+static u8 fb_backbuf[FB_MAX_WIDTH * FB_MAX_HEIGHT * 4] __attribute__((aligned(16)));
+
+static fb_rect_t fb_damage_list[FB_DAMAGE_MAX];
+static int       fb_damage_count = 0;
+
+// Page flipping: VRAM holds two pages, the hidden one is one frame
+// behind, so a present replays the previous frame's damage as well
+static void    (*fb_show_page)(int page);   // NULL = single buffered
+static u32       fb_page_bytes;
+static int       fb_visible_page;
+static fb_rect_t fb_prev_damage[FB_DAMAGE_MAX];
+static int       fb_prev_count = 0;
+
+static void fb_setup(void) {
+    // Modes larger than the static buffer draw straight to VRAM
+    if ((u32)fb.pitch * fb.height <= sizeof(fb_backbuf))
+        fb.back = fb_backbuf;
+    else
+        fb.back = (u8 *)fb.addr;
+
+    fb_screen.width  = (int)fb.width;
+    fb_screen.height = (int)fb.height;
+    fb_screen.pitch  = fb.pitch;
+    fb_screen.pixels = fb.back;
+    switch (fb.bpp) {
+        case 32: fb_screen.format = FB_FORMAT_XRGB8888; break;
+        case 24: fb_screen.format = FB_FORMAT_RGB888;   break;
+        case 16: fb_screen.format = FB_FORMAT_RGB565;   break;
+        default: fb_screen.format = FB_FORMAT_NONE;     break;
+    }
+    fb_bind(&fb_main, &fb_screen);
+    fb_damage_count = 0;
+    fb_show_page = NULL;
+    if (fb.vram_size < fb.pitch * fb.height)
+        fb.vram_size = fb.pitch * fb.height;
+    fb.mode_id++;
+    glyph_cache_reset();   // cached pixels are in the old format
+}
+
+static fb_rect_t rect_union(const fb_rect_t *a, const fb_rect_t *b) {
+    int x0 = a->x < b->x ? a->x : b->x;
+    int y0 = a->y < b->y ? a->y : b->y;
+    int x1 = a->x + a->w > b->x + b->w ? a->x + a->w : b->x + b->w;
+    int y1 = a->y + a->h > b->y + b->h ? a->y + a->h : b->y + b->h;
+    fb_rect_t u = { x0, y0, x1 - x0, y1 - y0 };
+    return u;
+}
+
+// Pixels the union of a and b covers that neither a nor b does
+static int merge_waste(const fb_rect_t *a, const fb_rect_t *b) {
+    fb_rect_t u = rect_union(a, b);
+    int ix = (a->x > b->x ? a->x : b->x);
+    int iy = (a->y > b->y ? a->y : b->y);
+    int iw = (a->x + a->w < b->x + b->w ? a->x + a->w : b->x + b->w) - ix;
+    int ih = (a->y + a->h < b->y + b->h ? a->y + a->h : b->y + b->h) - iy;
+    int inter = (iw > 0 && ih > 0) ? iw * ih : 0;
+    return u.w * u.h - a->w * a->h - b->w * b->h + inter;
+}
+
+// Record an already clipped screen rect as damaged
+static void fb_damage_screen(int x, int y, int w, int h) {
+    if (fb.back == (u8 *)fb.addr) return;
+    fb_rect_t r = { x, y, w, h };
+
+    // Absorb every rect that merges cheaply; a grown rect may now
+    // absorb one that was rejected earlier, so rescan after each hit
+    for (int i = 0; i < fb_damage_count; ) {
+        if (merge_waste(&r, &fb_damage_list[i]) <= FB_DAMAGE_SLACK) {
+            r = rect_union(&r, &fb_damage_list[i]);
+            fb_damage_list[i] = fb_damage_list[--fb_damage_count];
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+
+    if (fb_damage_count == FB_DAMAGE_MAX) {
+        // List full - fold into the entry that grows the least
+        int best = 0, best_waste = 0x7FFFFFFF;
+        for (int i = 0; i < fb_damage_count; i++) {
+            int waste = merge_waste(&r, &fb_damage_list[i]);
+            if (waste < best_waste) { best_waste = waste; best = i; }
+        }
+        r = rect_union(&r, &fb_damage_list[best]);
+        fb_damage_list[best] = fb_damage_list[--fb_damage_count];
+    }
+    fb_damage_list[fb_damage_count++] = r;
+}
+
+// Display list state, see DISPLAY LIST below
+static bool dl_recording = false;
+static bool dl_rendering = false;   // commands' damage is added up front
+static void dl_render(void);
+
+// Drawing tracepoint: fires when a primitive is called (drawn or
+// recorded), not again for each tile it is replayed into
+#define FB_TRACE(ev, a, b) \
+    do { if (__builtin_expect(trace_on, 0) && !dl_rendering) \
+             trace_emit((ev), (u32)(a), (u32)(b)); } while (0)
+
+// Damage from a primitive; off-screen targets have nothing to present
+static inline void fb_damage(int x, int y, int w, int h) {
+    if (fb_cx->target == &fb_screen && !dl_rendering)
+        fb_damage_screen(x, y, w, h);
+}
+
+static void fb_copy_row(u8 *dst, const u8 *src, u32 len) {
+    // dst and src share the same offset, so they share alignment too
+    while (len && ((u32)dst & 3)) { *dst++ = *src++; len--; }
+    u32 *d = (u32 *)dst;
+    const u32 *s = (const u32 *)src;
+    for (; len >= 4; len -= 4) *d++ = *s++;
+    dst = (u8 *)d; src = (const u8 *)s;
+    while (len--) *dst++ = *src++;
+}
+
+// Copy one damaged rect from the back buffer into a VRAM page
+static void fb_present_rect(u8 *vram, const fb_rect_t *r, u32 bpp) {
+    u32 off = (u32)r->y * fb.pitch + (u32)r->x * bpp;
+    u32 len = (u32)r->w * bpp;
+    if (r->x == 0 && r->w == (int)fb.width) {
+        // Full-width band: rows are contiguous, stream it in one go
+        blit_stream_copy(vram + off, fb.back + off, (size_t)r->h * fb.pitch);
+        return;
+    }
+    for (int row = 0; row < r->h; row++, off += fb.pitch) {
+        if (len >= 64) blit_stream_copy(vram + off, fb.back + off, len);
+        else           fb_copy_row(vram + off, fb.back + off, len);
+    }
+}
+
+bool fb_has_damage(void) {
+    return fb_damage_count > 0;
+}
+
+static void fb_present_pages(void) {
+    if (dl_recording) dl_render();
+    u8 *vram = (u8 *)fb.addr;
+    u32 bpp = fb_format_bytes(fb_screen.format);
+    if (!fb_show_page) {
+        for (int i = 0; i < fb_damage_count; i++)
+            fb_present_rect(vram, &fb_damage_list[i], bpp);
+        fb_damage_count = 0;
+        return;
+    }
+
+    // Visible page == back buffer already when nothing changed
+    if (fb_damage_count == 0) return;
+    fb_rect_t frame[FB_DAMAGE_MAX];
+    int frame_count = fb_damage_count;
+    kmemcpy(frame, fb_damage_list, sizeof(fb_rect_t) * frame_count);
+    for (int i = 0; i < fb_prev_count; i++) {
+        fb_rect_t *r = &fb_prev_damage[i];
+        fb_damage_screen(r->x, r->y, r->w, r->h);   // merges overlaps
+    }
+
+    int hidden = fb_visible_page ^ 1;
+    vram += (u32)hidden * fb_page_bytes;
+    for (int i = 0; i < fb_damage_count; i++)
+        fb_present_rect(vram, &fb_damage_list[i], bpp);
+    fb_show_page(hidden);
+    fb_visible_page = hidden;
+
+    kmemcpy(fb_prev_damage, frame, sizeof(fb_rect_t) * frame_count);
+    fb_prev_count   = frame_count;
+    fb_damage_count = 0;
+}
+
+void fb_present(void) {
+    TRACE(TRACE_FB_PRESENT, 0, fb_damage_count);
+    fb_present_pages();
+    TRACE(TRACE_FB_PRESENTED, 0, 0);
+}
+
+// Switch to a mode a display driver has just set; the caller redraws
+void fb_set_mode(u32 *vram, u32 width, u32 height, u32 pitch, u8 bpp) {
+    fb.addr         = vram;
+    fb.width        = width;
+    fb.height       = height;
+    fb.pitch        = pitch;
+    fb.bpp          = bpp;
+    fb.pitch_pixels = pitch / 4;
+    fb_setup();
+}
+
+// Present by flipping between two VRAM pages; show_page(n) makes
+// page n (at fb.addr + n * pitch * height) visible
+bool fb_enable_flip(void (*show_page)(int page)) {
+    fb_page_bytes = fb.pitch * fb.height;
+    if (fb.back == (u8 *)fb.addr || fb.vram_size < 2 * fb_page_bytes)
+        return false;
+    fb_show_page    = show_page;
+    fb_visible_page = 0;
+    fb_prev_count   = 0;
+    show_page(0);
+    // Page 1 holds nothing yet: the first present fills all of it
+    fb_damage_screen(0, 0, (int)fb.width, (int)fb.height);
+    return true;
+}
+
+bool fb_flipping(void) {
+    return fb_show_page != NULL;
+}
+
+// True when the current target's pixels live in the LFB
+static bool fb_target_is_vram(void) {
+    u8 *p = fb_cx->target->pixels, *vram = (u8 *)fb.addr;
+    return p >= vram && p < vram + fb.vram_size;
+}
+
+// Clip a rect to the clip rect; false when nothing is left
+static bool fb_clip(int *x, int *y, int *w, int *h) {
+    int x0 = *x, y0 = *y, x1 = *x + *w, y1 = *y + *h;
+    if (x0 < fb_cx->clip_x0) x0 = fb_cx->clip_x0;
+    if (y0 < fb_cx->clip_y0) y0 = fb_cx->clip_y0;
+    if (x1 > fb_cx->clip_x1) x1 = fb_cx->clip_x1;
+    if (y1 > fb_cx->clip_y1) y1 = fb_cx->clip_y1;
+    if (x0 >= x1 || y0 >= y1) return false;
+    *x = x0; *y = y0; *w = x1 - x0; *h = y1 - y0;
+    return true;
+}
+
+static inline u8 *fb_row_ptr(int x, int y) {
+    return fb_cx->target->pixels + (u32)y * fb_cx->target->pitch + (u32)x * fb_cx->bytespp;
+}
+
+// ============================================================
+// VRAM CACHING
+// ============================================================
+static const char *fb_cache_desc = "uncached (firmware default)";
+
+void fb_enable_write_combining(void) {
+    if (!fb.addr || fb_screen.format == FB_FORMAT_NONE) return;
+    u32 size = fb.vram_size;
+
+    if (cpu_paging_enabled()) {
+        // VRAM is not mapped until here. PAT WC pages are enough;
+        // without PAT, map it write-back and let an MTRR make it WC.
+        if (cpu_has(CPUID_EDX_PAT)) {
+            if (!paging_map_mmio((u32)fb.addr, size, PAGE_CACHE_WC)) return;
+            fb_cache_desc = "write-combining (PAT)";
+            return;
+        }
+        paging_map_mmio((u32)fb.addr, size, PAGE_CACHE_WB);
+    } else {
+        pat_init();
+    }
+    int used = mtrr_set_wc((u32)fb.addr, size);
+    if (used > 0) {
+        static char desc[40];
+        ksprintf(desc, "write-combining (%d MTRR)", used);
+        fb_cache_desc = desc;
+    } else if (used < 0) {
+        fb_cache_desc = "uncached (UC MTRR overlaps LFB)";
+    } else {
+        fb_cache_desc = "uncached (no free WC MTRR)";
+    }
+}
+
+const char *fb_cache_mode(void) {
+    return fb_cache_desc;
+}
+
+// Push whole frames from the back buffer to VRAM for ~200 ms.
+// Leaves the screen showing the current back buffer.
+u32 fb_measure_bandwidth(void) {
+    u32 frame = fb.pitch * fb.height;
+    if (fb.back == (u8 *)fb.addr || frame < 1024) return 0;
+
+    u64 t0 = ktime_ns(), ns;
+    u64 bytes = 0;
+    do {
+        blit_stream_copy((u8 *)fb.addr, fb.back, frame);
+        bytes += frame;
+    } while ((ns = ktime_ns() - t0) < 200000000ull);
+    return (u32)kdiv64((bytes * 1000000000ull) >> 20, (u32)ns, NULL);  // MB/s
+}
+
 // ============================================================
 // FRAMEBUFFER INIT - Multiboot 1
 // ============================================================
@@ -119,6 +637,7 @@ void fb_init(multiboot_info_t *mbi) {
     fb.height        = mbi->framebuffer_height;
     fb.bpp          = mbi->framebuffer_bpp;
     fb.pitch_pixels = mbi->framebuffer_pitch / 4;
+    fb_setup();
 }
 
 // ============================================================
@@ -139,6 +658,7 @@ void fb_init_mb2(mb2_info_t *mb2) {
             fb.height        = fbtag->framebuffer_height;
             fb.bpp          = fbtag->framebuffer_bpp;
             fb.pitch_pixels = fbtag->framebuffer_pitch / 4;
+            fb_setup();
             return;
         }
         u32 next = (tag->size + 7) & ~7u;
@@ -151,56 +671,536 @@ void fb_init_mb2(mb2_info_t *mb2) {
     fb.height        = 600;
     fb.bpp          = 32;
     fb.pitch_pixels = 800;
+    fb_setup();
+}
+
+// ============================================================
+// DISPLAY LIST - RECORDING
+// Between fb_list_begin() and fb_list_end(), primitives aimed at
+// the screen are recorded instead of drawn. Each command keeps the
+// box of pixels it may touch (already clipped) and whether it paints
+// every one of them opaquely; rendering is further down. Lists nest
+// (only the outermost end draws) and may be limited to a region, a
+// set of disjoint rects such as a window's visible parts.
+// ============================================================
+#define DL_TILE         64
+#define DL_MAX_CMDS     512
+#define DL_TEXT_BYTES   8192
+#define DL_MAX_BINNED   8192    // (command, tile) pairs per render
+#define DL_TILES_X      ((FB_MAX_WIDTH  + DL_TILE - 1) / DL_TILE)
+#define DL_TILES_Y      ((FB_MAX_HEIGHT + DL_TILE - 1) / DL_TILE)
+#define DL_OCCLUDERS    8       // opaque rects remembered per tile
+
+#define DL_FILL     0
+#define DL_TEXT     1
+#define DL_LINE     2
+#define DL_RING     3
+#define DL_MASK     4
+#define DL_BLIT     5
+#define DL_RESTORE  6
+
+typedef struct {
+    u8  op;
+    u8  opaque;             // every pixel in box is painted opaquely
+    fb_rect_t box;          // screen pixels the command may touch
+    int p[7];
+    u32 color, color2;
+    const void *ptr;        // text copy, mask, surface or snapshot
+} dl_cmd_t;
+
+static dl_cmd_t dl_cmds[DL_MAX_CMDS];
+static int      dl_count = 0;
+static char     dl_text[DL_TEXT_BYTES];
+static u32      dl_text_used = 0;
+static int      dl_depth = 0;
+static const fb_rect_t *dl_region = NULL;  // NULL = whole screen
+static int      dl_region_n = 0;
+
+static inline bool dl_active(void) {
+    return dl_recording && fb_cx->target == &fb_screen;
+}
+
+// Make room for one command and text_bytes of text, rendering what
+// is queued if either pool is full
+static void dl_reserve(u32 text_bytes) {
+    if (dl_count == DL_MAX_CMDS || dl_text_used + text_bytes > DL_TEXT_BYTES)
+        dl_render();
+}
+
+// Queue a command over the visible part of a box; NULL if none is
+static dl_cmd_t *dl_push(u8 op, int x, int y, int w, int h, bool opaque) {
+    if (!fb_clip(&x, &y, &w, &h)) return NULL;
+    dl_cmd_t *c = &dl_cmds[dl_count++];
+    c->op = op;
+    c->opaque = opaque;
+    c->box.x = x; c->box.y = y; c->box.w = w; c->box.h = h;
+    return c;
+}
+
+static void dl_record_ring(int cx, int cy, int r_in, int r_out, u32 color, bool aa) {
+    dl_reserve(0);
+    int m = r_out + 2;
+    dl_cmd_t *c = dl_push(DL_RING, cx - m, cy - m, 2 * m + 1, 2 * m + 1, false);
+    if (!c) return;
+    c->p[0] = cx; c->p[1] = cy; c->p[2] = r_in; c->p[3] = r_out; c->p[4] = aa;
+    c->color = color;
+}
+
+// The rects must stay valid until the matching fb_list_end()
+void fb_list_begin_region(const fb_rect_t *rects, int n) {
+    if (dl_depth++ > 0) return;
+    dl_region    = rects;
+    dl_region_n  = n;
+    dl_recording = true;
+}
+
+void fb_list_begin(void) {
+    fb_list_begin_region(NULL, 0);
+}
+
+void fb_list_end(void) {
+    if (dl_depth == 0 || --dl_depth > 0) return;
+    dl_render();
+    dl_recording = false;
+    dl_region = NULL;
 }
 
 // ============================================================
 // BASIC PIXEL OPERATIONS
 // ============================================================
-void fb_put_pixel(int x, int y, u32 color) {
-    if (x < 0 || y < 0 || (u32)x >= fb.width || (u32)y >= fb.height)
+static inline void fb_plot(int x, int y, u32 color) {
+    if (x < fb_cx->clip_x0 || y < fb_cx->clip_y0 || x >= fb_cx->clip_x1 || y >= fb_cx->clip_y1)
         return;
+    fb_cx->span(fb_row_ptr(x, y), 1, fb_cx->pack(color));
+}
 
-    u8 *base = (u8 *)fb.addr;
+// Clipped horizontal span [x0, x1] on row y (no damage tracking)
+static inline void fb_hspan(int x0, int x1, int y, u32 px) {
+    if (y < fb_cx->clip_y0 || y >= fb_cx->clip_y1) return;
+    if (x0 < fb_cx->clip_x0) x0 = fb_cx->clip_x0;
+    if (x1 >= fb_cx->clip_x1) x1 = fb_cx->clip_x1 - 1;
+    if (x0 > x1) return;
+    fb_cx->span(fb_row_ptr(x0, y), x1 - x0 + 1, px);
+}
+
+// Read a target pixel back as 0x00RRGGBB
+static u32 fb_read_pixel(int x, int y) {
+    return px_read(fb_row_ptr(x, y), fb_cx->target->format) & 0x00FFFFFF;
+}
+
+// Blend color over the pixel at (x, y) with alpha 0..256
+static void fb_blend_pixel(int x, int y, u32 color, u32 alpha) {
+    if (x < fb_cx->clip_x0 || y < fb_cx->clip_y0 || x >= fb_cx->clip_x1 || y >= fb_cx->clip_y1 || alpha == 0)
+        return;
+    u32 dst = alpha >= 256 ? 0 : fb_read_pixel(x, y);
+    u32 inv = 256 - alpha;
+    u32 rb = (((color & 0xFF00FF) * alpha + (dst & 0xFF00FF) * inv) >> 8) & 0xFF00FF;
+    u32 g  = (((color & 0x00FF00) * alpha + (dst & 0x00FF00) * inv) >> 8) & 0x00FF00;
+    fb_cx->span(fb_row_ptr(x, y), 1, fb_cx->pack(rb | g));
+}
+
+// Damage the on-screen part of a bounding box
+static void fb_damage_box(int x, int y, int w, int h) {
+    if (fb_clip(&x, &y, &w, &h))
+        fb_damage(x, y, w, h);
+}
+
+// Pixels plotted in a row or column in one colour extend the last
+// fill instead of queueing a 1x1 command each
+static void dl_record_pixel(int x, int y, u32 color) {
+    if (x < fb_cx->clip_x0 || y < fb_cx->clip_y0 || x >= fb_cx->clip_x1 || y >= fb_cx->clip_y1)
+        return;
+    if (dl_count > 0) {
+        dl_cmd_t *c = &dl_cmds[dl_count - 1];
+        fb_rect_t *b = &c->box;
+        if (c->op == DL_FILL && c->color == color) {
+            if (b->h == 1 && b->y == y && b->x + b->w == x) { b->w++; return; }
+            if (b->w == 1 && b->x == x && b->y + b->h == y) { b->h++; return; }
+        }
+    }
+    fb_fill_rect(x, y, 1, 1, color);
+}
+
+// Between fb_pixels_begin() and fb_pixels_end() plotted pixels only
+// grow a bounding box, reported as damage once at the end instead of
+// merging a 1x1 rect per pixel. The target must not change in between.
+static int fb_px_depth = 0;
+static int fb_px_x0, fb_px_y0, fb_px_x1, fb_px_y1;
+
+void fb_pixels_begin(void) {
+    if (fb_px_depth++ > 0) return;
+    fb_px_x0 = fb_px_y0 = 0x7FFFFFFF;
+    fb_px_x1 = fb_px_y1 = -0x7FFFFFFF;
+}
+
+void fb_pixels_end(void) {
+    if (fb_px_depth == 0 || --fb_px_depth > 0) return;
+    if (fb_px_x0 <= fb_px_x1)
+        fb_damage(fb_px_x0, fb_px_y0, fb_px_x1 - fb_px_x0 + 1, fb_px_y1 - fb_px_y0 + 1);
+}
 
-    if (fb.bpp == 32) {
-        u32 *p = (u32 *)(base + (u32)y * fb.pitch + (u32)x * 4);
-        *p = color;
-    } else if (fb.bpp == 24) {
-        u8 *p = base + (u32)y * fb.pitch + (u32)x * 3;
-        p[0] = (u8)(color);
-        p[1] = (u8)(color >> 8);
-        p[2] = (u8)(color >> 16);
-    } else if (fb.bpp == 16) {
-        u8  r5 = (u8)((color >> 16) & 0xFF) >> 3;
-        u8  g6 = (u8)((color >>  8) & 0xFF) >> 2;
-        u8  b5 = (u8)((color >>  0) & 0xFF) >> 3;
-        u16 px = (u16)((r5 << 11) | (g6 << 5) | b5);
-        u16 *p = (u16 *)(base + (u32)y * fb.pitch + (u32)x * 2);
-        *p = px;
+void fb_put_pixel(int x, int y, u32 color) {
+    if (dl_active()) { dl_record_pixel(x, y, color); return; }
+    if (x < fb_cx->clip_x0 || y < fb_cx->clip_y0 || x >= fb_cx->clip_x1 || y >= fb_cx->clip_y1)
+        return;
+    fb_cx->span(fb_row_ptr(x, y), 1, fb_cx->pack(color));
+    if (fb_px_depth == 0) {
+        fb_damage(x, y, 1, 1);
+        return;
     }
+    if (x < fb_px_x0) fb_px_x0 = x;
+    if (x > fb_px_x1) fb_px_x1 = x;
+    if (y < fb_px_y0) fb_px_y0 = y;
+    if (y > fb_px_y1) fb_px_y1 = y;
 }
 
 void fb_clear(u32 color) {
-    for (u32 y = 0; y < fb.height; y++)
-        for (u32 x = 0; x < fb.width; x++)
-            fb_put_pixel((int)x, (int)y, color);
+    fb_fill_rect(0, 0, fb_cx->target->width, fb_cx->target->height, color);
 }
 
 void fb_fill_rect(int x, int y, int w, int h, u32 color) {
-    for (int row = y; row < y + h; row++)
-        for (int col = x; col < x + w; col++)
-            fb_put_pixel(col, row, color);
+    FB_TRACE(TRACE_FB_FILL, w, h);
+    if (dl_active()) {
+        dl_reserve(0);
+        dl_cmd_t *c = dl_push(DL_FILL, x, y, w, h, true);
+        if (c) c->color = color;
+        return;
+    }
+    if (!fb_clip(&x, &y, &w, &h)) return;
+    fb_damage(x, y, w, h);
+    u32 px  = fb_cx->pack(color);
+    u8 *row = fb_row_ptr(x, y);
+
+    // Big 32 bpp fills straight to VRAM never get read back: stream
+    // them. RAM targets are read again by present/blits, keep them cached.
+    if (fb_cx->bytespp == 4 && (u32)w * h * 4 >= FB_STREAM_MIN && fb_target_is_vram()) {
+        while (h--) {
+            blit_stream_fill32(row, px, (size_t)w);
+            row += fb_cx->target->pitch;
+        }
+        return;
+    }
+    while (h--) {
+        fb_cx->span(row, w, px);
+        row += fb_cx->target->pitch;
+    }
 }
 
 void fb_draw_rect(int x, int y, int w, int h, u32 color, int thickness) {
-    for (int t = 0; t < thickness; t++) {
-        for (int col = x; col < x + w; col++) {
-            fb_put_pixel(col, y + t, color);
-            fb_put_pixel(col, y + h - 1 - t, color);
+    if (w <= 0 || h <= 0 || thickness <= 0) return;
+    if (thickness * 2 >= w || thickness * 2 >= h) {
+        fb_fill_rect(x, y, w, h, color);
+        return;
+    }
+    fb_fill_rect(x, y, w, thickness, color);                              // top
+    fb_fill_rect(x, y + h - thickness, w, thickness, color);              // bottom
+    fb_fill_rect(x, y + thickness, thickness, h - 2 * thickness, color);  // left
+    fb_fill_rect(x + w - thickness, y + thickness, thickness, h - 2 * thickness, color); // right
+}
+
+// ============================================================
+// RECT SNAPSHOTS & SCROLLING
+// Copy an on-screen rect to/from a tightly packed buffer
+// (stride = w * bytes per pixel) in the current pixel format.
+// ============================================================
+u32 fb_snapshot(int x, int y, int w, int h, void *dst, u32 cap) {
+    if (dl_active()) dl_render();   // reads pixels: draw what is queued
+    int cx = x, cy = y, cw = w, ch = h;
+    if (!fb_clip(&cx, &cy, &cw, &ch) || cx != x || cy != y || cw != w || ch != h)
+        return 0;
+    u32 stride = (u32)w * fb_cx->bytespp;
+    if (stride * (u32)h > cap) return 0;
+    u8 *src = fb_row_ptr(x, y), *out = dst;
+    for (int row = 0; row < h; row++, src += fb_cx->target->pitch, out += stride)
+        blit_copy(out, src, stride);
+    return stride * (u32)h;
+}
+
+void fb_restore(int x, int y, int w, int h, const void *src) {
+    if (dl_active()) {
+        dl_reserve(0);
+        dl_cmd_t *c = dl_push(DL_RESTORE, x, y, w, h, true);
+        if (!c) return;
+        c->p[0] = x; c->p[1] = y; c->p[2] = w; c->p[3] = h;
+        c->ptr = src;
+        return;
+    }
+    int cx = x, cy = y, cw = w, ch = h;
+    if (!fb_clip(&cx, &cy, &cw, &ch)) return;
+    fb_damage(cx, cy, cw, ch);
+    u32 stride = (u32)w * fb_cx->bytespp;
+    const u8 *in = (const u8 *)src + (u32)(cy - y) * stride + (u32)(cx - x) * fb_cx->bytespp;
+    u8 *dst = fb_row_ptr(cx, cy);
+    for (int row = 0; row < ch; row++, dst += fb_cx->target->pitch, in += stride)
+        blit_copy(dst, in, (u32)cw * fb_cx->bytespp);
+}
+
+// Shift the pixels of a rect by dy rows (negative = up), one row
+// copy per line. Rows shifted in keep their old pixels; the caller
+// repaints them.
+void fb_scroll_rect(int x, int y, int w, int h, int dy) {
+    if (dl_active()) dl_render();
+    if (!fb_clip(&x, &y, &w, &h) || dy == 0 || abs(dy) >= h) return;
+    fb_damage(x, y, w, h);
+    u32 len = (u32)w * fb_cx->bytespp;
+    int rows = h - abs(dy);
+    int step = dy < 0 ? (int)fb_cx->target->pitch : -(int)fb_cx->target->pitch;
+    u8 *dst = dy < 0 ? fb_row_ptr(x, y) : fb_row_ptr(x, y + h - 1);
+    u8 *src = dst - dy * (int)fb_cx->target->pitch;
+    for (; rows--; dst += step, src += step)
+        blit_copy(dst, src, len);
+}
+
+// ============================================================
+// SURFACE BLITS
+// Copy a rect between surfaces (NULL = screen), converting pixel
+// formats per row. Content can be drawn once in 32 bpp and pushed
+// to whatever mode the screen is in.
+// ============================================================
+#define BLIT_COPY   0
+#define BLIT_KEY    1
+#define BLIT_ALPHA  2
+
+// Clip a blit against the source and the destination's drawable
+// area (its clip rect when it is the current target)
+static bool blit_clip(const fb_surface_t *dst, int *dx, int *dy,
+                      const fb_surface_t *src, int *sx, int *sy, int *w, int *h) {
+    int x0 = 0, y0 = 0, x1 = dst->width, y1 = dst->height;
+    if (dst == fb_cx->target) {
+        x0 = fb_cx->clip_x0; y0 = fb_cx->clip_y0; x1 = fb_cx->clip_x1; y1 = fb_cx->clip_y1;
+    }
+    if (*sx < 0) { *dx -= *sx; *w += *sx; *sx = 0; }
+    if (*sy < 0) { *dy -= *sy; *h += *sy; *sy = 0; }
+    if (*dx < x0) { *sx += x0 - *dx; *w -= x0 - *dx; *dx = x0; }
+    if (*dy < y0) { *sy += y0 - *dy; *h -= y0 - *dy; *dy = y0; }
+    if (*w > src->width  - *sx) *w = src->width  - *sx;
+    if (*h > src->height - *sy) *h = src->height - *sy;
+    if (*w > x1 - *dx) *w = x1 - *dx;
+    if (*h > y1 - *dy) *h = y1 - *dy;
+    return *w > 0 && *h > 0;
+}
+
+static void convert_row(u8 *dst, u32 dfmt, const u8 *src, u32 sfmt, int w) {
+    u32 db = fb_format_bytes(dfmt), sb = fb_format_bytes(sfmt);
+    if (dfmt == sfmt || (sb == 4 && dfmt == FB_FORMAT_XRGB8888)) {
+        blit_copy(dst, src, (u32)w * db);
+        return;
+    }
+    const u32 *s = (const u32 *)src;
+    if (sb == 4 && dfmt == FB_FORMAT_RGB565) {
+        u16 *d = (u16 *)dst;
+        while (w--) *d++ = (u16)pack_rgb565(*s++);
+        return;
+    }
+    if (sb == 4 && dfmt == FB_FORMAT_RGB888) {
+        // Four pixels (BGRX x4) become three dwords (BGRB GRBG RBGR)
+        u32 *d = (u32 *)dst;
+        for (; w >= 4; w -= 4, s += 4, d += 3) {
+            d[0] = (s[0] & 0xFFFFFF) | (s[1] << 24);
+            d[1] = ((s[1] >> 8) & 0xFFFF) | (s[2] << 16);
+            d[2] = ((s[2] >> 16) & 0xFF) | (s[3] << 8);
+        }
+        for (dst = (u8 *)d; w--; dst += 3) px_write(dst, dfmt, *s++);
+        return;
+    }
+    for (; w--; dst += db, src += sb)
+        px_write(dst, dfmt, px_read(src, sfmt));
+}
+
+// Pixels equal to key (0x00RRGGBB) are skipped
+static void key_row(u8 *dst, u32 dfmt, const u8 *src, u32 sfmt, int w, u32 key) {
+    u32 db = fb_format_bytes(dfmt), sb = fb_format_bytes(sfmt);
+    for (; w--; dst += db, src += sb) {
+        u32 c = px_read(src, sfmt);
+        if ((c & 0xFFFFFF) != key) px_write(dst, dfmt, c);
+    }
+}
+
+// Source alpha (0xFF for opaque formats) scaled by alpha 0..255, "over" dst
+static void alpha_row(u8 *dst, u32 dfmt, const u8 *src, u32 sfmt, int w, u32 alpha) {
+    u32 db = fb_format_bytes(dfmt), sb = fb_format_bytes(sfmt);
+    for (; w--; dst += db, src += sb) {
+        u32 c = px_read(src, sfmt);
+        u32 a = ((c >> 24) * alpha + 127) / 255;
+        if (a == 0) continue;
+        if (a < 255) {
+            u32 d = px_read(dst, dfmt);
+            u32 w8 = a + (a >> 7), inv = 256 - w8;
+            u32 rb = (((c & 0xFF00FF) * w8 + (d & 0xFF00FF) * inv) >> 8) & 0xFF00FF;
+            u32 g  = (((c & 0x00FF00) * w8 + (d & 0x00FF00) * inv) >> 8) & 0x00FF00;
+            u32 da = a + ((d >> 24) * (255 - a) + 127) / 255;
+            c = (da << 24) | rb | g;
+        }
+        px_write(dst, dfmt, c);
+    }
+}
+
+static void blit_rows(fb_surface_t *dst, int dx, int dy, const fb_surface_t *src,
+                      int sx, int sy, int w, int h, int mode, u32 arg) {
+    if (!dst) dst = &fb_screen;
+    if (!src) src = &fb_screen;
+    if (dst->format == FB_FORMAT_NONE || src->format == FB_FORMAT_NONE) return;
+    if (!blit_clip(dst, &dx, &dy, src, &sx, &sy, &w, &h)) return;
+    if (src == &fb_screen && dl_recording) dl_render();    // reads the screen
+    if (dst == &fb_screen && dl_recording) {
+        dl_reserve(0);
+        dl_cmd_t *c = dl_push(DL_BLIT, dx, dy, w, h, mode == BLIT_COPY);
+        if (!c) return;
+        c->p[0] = dx; c->p[1] = dy; c->p[2] = sx; c->p[3] = sy;
+        c->p[4] = w;  c->p[5] = h;  c->p[6] = mode;
+        c->color = arg;
+        c->ptr = src;
+        return;
+    }
+    if (dst == &fb_screen && !dl_rendering) fb_damage_screen(dx, dy, w, h);
+
+    u8 *d = dst->pixels + (u32)dy * dst->pitch + (u32)dx * fb_format_bytes(dst->format);
+    const u8 *s = src->pixels + (u32)sy * src->pitch + (u32)sx * fb_format_bytes(src->format);
+    if (mode == BLIT_KEY) {
+        // Compare in the source's precision (a 565 key loses low bits)
+        u8 k[4];
+        px_write(k, src->format, arg);
+        arg = px_read(k, src->format) & 0xFFFFFF;
+    }
+    for (; h--; d += dst->pitch, s += src->pitch) {
+        switch (mode) {
+            case BLIT_COPY: convert_row(d, dst->format, s, src->format, w); break;
+            case BLIT_KEY:  key_row(d, dst->format, s, src->format, w, arg); break;
+            default:        alpha_row(d, dst->format, s, src->format, w, arg); break;
+        }
+    }
+}
+
+void fb_blit(fb_surface_t *dst, int dx, int dy, const fb_surface_t *src) {
+    if (!src) src = &fb_screen;
+    blit_rows(dst, dx, dy, src, 0, 0, src->width, src->height, BLIT_COPY, 0);
+}
+
+void fb_blit_rect(fb_surface_t *dst, int dx, int dy, const fb_surface_t *src,
+                  int sx, int sy, int w, int h) {
+    blit_rows(dst, dx, dy, src, sx, sy, w, h, BLIT_COPY, 0);
+}
+
+void fb_blit_key(fb_surface_t *dst, int dx, int dy, const fb_surface_t *src,
+                 int sx, int sy, int w, int h, u32 key) {
+    blit_rows(dst, dx, dy, src, sx, sy, w, h, BLIT_KEY, key);
+}
+
+void fb_blit_alpha(fb_surface_t *dst, int dx, int dy, const fb_surface_t *src,
+                   int sx, int sy, int w, int h, u32 alpha) {
+    if (alpha > 255) alpha = 255;
+    blit_rows(dst, dx, dy, src, sx, sy, w, h, BLIT_ALPHA, alpha);
+}
+
+// ============================================================
+// 1BPP MASKS
+// A mask (MSB first, `stride` bytes per row) is compiled once into
+// per-row runs of set bits; drawing it is one span per run.
+// Stream per row: count, then start/length pairs.
+// ============================================================
+#define MASK_SLOTS      4
+#define MASK_RUN_WORDS  8192
+
+typedef struct {
+    const u8 *mask;
+    int w, h, stride;
+    u32 first;              // offset into mask_runs
+} mask_slot_t;
+
+static mask_slot_t mask_slots[MASK_SLOTS];
+static int mask_slot_count = 0;
+static u16 mask_runs[MASK_RUN_WORDS];
+static u32 mask_runs_used = 0;
+
+// Append the runs of one mask to the pool; false if it does not fit
+static bool mask_compile(mask_slot_t *m) {
+    u32 pos = mask_runs_used;
+    for (int row = 0; row < m->h; row++) {
+        const u8 *bits = m->mask + (u32)row * m->stride;
+        if (pos >= MASK_RUN_WORDS) return false;
+        u32 count_at = pos++;
+        mask_runs[count_at] = 0;
+        for (int x = 0; x < m->w; ) {
+            if (!(bits[x >> 3] & (0x80 >> (x & 7)))) { x++; continue; }
+            int start = x;
+            while (x < m->w && (bits[x >> 3] & (0x80 >> (x & 7)))) x++;
+            if (pos + 2 > MASK_RUN_WORDS) return false;
+            mask_runs[pos++] = (u16)start;
+            mask_runs[pos++] = (u16)(x - start);
+            mask_runs[count_at]++;
+        }
+    }
+    m->first = mask_runs_used;
+    mask_runs_used = pos;
+    return true;
+}
+
+static const mask_slot_t *mask_lookup(const u8 *mask, int w, int h, int stride) {
+    for (int i = 0; i < mask_slot_count; i++) {
+        mask_slot_t *m = &mask_slots[i];
+        if (m->mask == mask && m->w == w && m->h == h && m->stride == stride)
+            return m;
+    }
+    if (dl_rendering) return NULL;      // replay only reads the cache
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (mask_slot_count == MASK_SLOTS || attempt) {
+            mask_slot_count = 0;        // full: start the cache over
+            mask_runs_used  = 0;
+        }
+        mask_slot_t *m = &mask_slots[mask_slot_count];
+        m->mask = mask; m->w = w; m->h = h; m->stride = stride;
+        if (mask_compile(m)) {
+            mask_slot_count++;
+            return m;
+        }
+    }
+    return NULL;                        // larger than the whole pool
+}
+
+void fb_blit_mask(const u8 *mask, int w, int h, int stride, int x, int y, u32 color) {
+    if (w <= 0 || h <= 0 || w > 0xFFFF || stride * 8 < w) return;
+    if (dl_active()) {
+        dl_reserve(0);
+        dl_cmd_t *c = dl_push(DL_MASK, x, y, w, h, false);
+        if (!c) return;
+        c->p[0] = w; c->p[1] = h; c->p[2] = stride; c->p[3] = x; c->p[4] = y;
+        c->color = color;
+        c->ptr = mask;
+        mask_lookup(mask, w, h, stride);    // compile now, the replay only reads
+        return;
+    }
+    const mask_slot_t *m = mask_lookup(mask, w, h, stride);
+    fb_damage_box(x, y, w, h);
+
+    u32 px = fb_cx->pack(color);
+    if (!m) {
+        // Not cached (or bigger than the pool): walk the bits
+        for (int row = 0; row < h; row++) {
+            int yy = y + row;
+            if (yy < fb_cx->clip_y0 || yy >= fb_cx->clip_y1) continue;
+            const u8 *bits = mask + (u32)row * stride;
+            for (int col = 0; col < w; ) {
+                if (!(bits[col >> 3] & (0x80 >> (col & 7)))) { col++; continue; }
+                int start = col;
+                while (col < w && (bits[col >> 3] & (0x80 >> (col & 7)))) col++;
+                int x0 = x + start, x1 = x + col;
+                if (x0 < fb_cx->clip_x0) x0 = fb_cx->clip_x0;
+                if (x1 > fb_cx->clip_x1) x1 = fb_cx->clip_x1;
+                if (x0 < x1) fb_cx->span(fb_row_ptr(x0, yy), x1 - x0, px);
+            }
         }
-        for (int row = y; row < y + h; row++) {
-            fb_put_pixel(x + t, row, color);
-            fb_put_pixel(x + w - 1 - t, row, color);
+        return;
+    }
+    const u16 *run = &mask_runs[m->first];
+    for (int row = 0; row < h; row++) {
+        u32 n = *run++;
+        int yy = y + row;
+        if (yy < fb_cx->clip_y0 || yy >= fb_cx->clip_y1) { run += 2 * n; continue; }
+        for (; n; n--, run += 2) {
+            int x0 = x + run[0], x1 = x0 + run[1];
+            if (x0 < fb_cx->clip_x0) x0 = fb_cx->clip_x0;
+            if (x1 > fb_cx->clip_x1) x1 = fb_cx->clip_x1;
+            if (x0 < x1) fb_cx->span(fb_row_ptr(x0, yy), x1 - x0, px);
         }
     }
 }
@@ -208,55 +1208,163 @@ void fb_draw_rect(int x, int y, int w, int h, u32 color, int thickness) {
 // ============================================================
 // TEXT & LOGO RENDERING
 // ============================================================
-void fb_draw_char(int x, int y, char c, u32 fg, u32 bg, int scale) {
+static inline int glyph_index(char c) {
     unsigned char uc = (unsigned char)c;
     if (uc >= 128) uc = '?';
-    const u8 *glyph = font8x8[uc];
-
-    for (int row = 0; row < 8; row++) {
-        for (int col = 0; col < 8; col++) {
-            u32 pixel_color = (glyph[row] & (0x01 << col)) ? fg : bg;
-            if (pixel_color == bg && bg == 0x00000000) continue; // "Transparent"
-            for (int sy = 0; sy < scale; sy++)
-                for (int sx = 0; sx < scale; sx++)
-                    fb_put_pixel(x + col*scale + sx, y + row*scale + sy, pixel_color);
-        }
+    if (uc < GLYPH_FIRST) uc = ' ';
+    return uc - GLYPH_FIRST;
+}
+
+static inline bool glyph_ready(const glyph_slot_t *slot, int idx) {
+    return (slot->ready[idx >> 5] & (1u << (idx & 31))) != 0;
+}
+
+// Expand one glyph into a slot: each lit/unlit bit becomes a scale-wide span
+static const u8 *glyph_pixels(glyph_slot_t *slot, int idx, int scale) {
+    int gs = 8 * scale;
+    u32 stride = (u32)gs * fb_cx->bytespp;
+    u8 *dst = slot->pixels + (u32)idx * gs * stride;
+    if (glyph_ready(slot, idx))
+        return dst;
+
+    const u8 *glyph = font8x8[idx + GLYPH_FIRST];
+    u32 pf = fb_cx->pack(slot->fg), pb = fb_cx->pack(slot->bg);
+    u8 *row = dst;
+    for (int r = 0; r < 8; r++) {
+        for (int col = 0; col < 8; col++)
+            fb_cx->span(row + (u32)col * scale * fb_cx->bytespp, scale,
+                    (glyph[r] & (1 << col)) ? pf : pb);
+        for (int sy = 1; sy < scale; sy++)
+            fb_copy_row(row + sy * stride, row, stride);
+        row += scale * stride;
     }
+    slot->ready[idx >> 5] |= 1u << (idx & 31);
+    return dst;
 }
 
-void fb_draw_string(int x, int y, const char *s, u32 fg, u32 bg, int scale) {
-    int cur_x = x;
-    while (*s) {
-        fb_draw_char(cur_x, y, *s, fg, bg, scale);
-        cur_x += 8 * scale;
-        s++;
+// Find (or evict the oldest slot for) a color pair; NULL = not cacheable
+static glyph_slot_t *glyph_slot_for(u32 fg, u32 bg, int scale) {
+    if (bg == COLOR_TRANSPARENT || scale < 1 || scale > 2 || fb_cx->bytespp == 0)
+        return NULL;
+    if (fb_cx->target->format != fb_screen.format)   // slots hold screen pixels
+        return NULL;
+    glyph_slot_t *slots = scale == 1 ? glyph_slots_s1 : glyph_slots_s2;
+    int count = scale == 1 ? GLYPH_SLOTS_S1 : GLYPH_SLOTS_S2;
+
+    glyph_slot_t *victim = &slots[0];
+    for (int i = 0; i < count; i++) {
+        glyph_slot_t *sl = &slots[i];
+        if (sl->stamp && sl->fg == fg && sl->bg == bg) {
+            if (!dl_rendering) sl->stamp = ++glyph_clock;
+            return sl;
+        }
+        if (sl->stamp < victim->stamp) victim = sl;
     }
+    if (dl_rendering) return NULL;      // replay only reads the cache
+    victim->fg = fg;
+    victim->bg = bg;
+    victim->stamp = ++glyph_clock;
+    kmemset(victim->ready, 0, sizeof(victim->ready));
+    return victim;
 }
 
-void fb_draw_logo(int start_x, int start_y, u32 color) {
-    // logo_bits to nazwa tablicy z Twojego nowego pliku output.c
-    extern unsigned char arctic_logo[]; 
-    
-    const int bytes_per_row = 13; // KLUCZOWE: 13 bajtów na wiersz
-
-    for (int y = 0; y < 100; y++) {
-        for (int b = 0; b < bytes_per_row; b++) {
-            unsigned char data = arctic_logo[y * bytes_per_row + b];
-            
-            for (int bit = 0; bit < 8; bit++) {
-                int x = b * 8 + bit;
-                
-                // Rysujemy tylko 100 pikseli, ignorujemy 4 bity paddingu na końcu
-                if (x < 100) {
-                    // Wyciągamy bit (MSB first - zgodnie ze skryptem CoddyAI)
-                    if (data & (1 << (7 - bit))) {
-                        fb_put_pixel(start_x + x, start_y + y, color);
-                    }
-                }
+// Draw one glyph with a single clip check. Cached glyphs are copied
+// row by row; transparent or odd-scale glyphs are drawn as bit runs.
+static void glyph_draw(int x, int y, int idx, u32 fg, u32 bg, int scale,
+                       glyph_slot_t *slot) {
+    int gs = 8 * scale;
+    int cx = x, cy = y, cw = gs, ch = gs;
+    if (!fb_clip(&cx, &cy, &cw, &ch)) return;
+
+    if (slot && dl_rendering && !glyph_ready(slot, idx))
+        slot = NULL;                    // replay does not expand glyphs
+    if (slot) {
+        u32 stride = (u32)gs * fb_cx->bytespp;
+        const u8 *src = glyph_pixels(slot, idx, scale)
+                      + (u32)(cy - y) * stride + (u32)(cx - x) * fb_cx->bytespp;
+        u8 *dst = fb_row_ptr(cx, cy);
+        u32 len = (u32)cw * fb_cx->bytespp;
+        while (ch--) {
+            fb_copy_row(dst, src, len);
+            dst += fb_cx->target->pitch;
+            src += stride;
+        }
+        return;
+    }
+
+    const u8 *glyph = font8x8[idx + GLYPH_FIRST];
+    bool opaque = (bg != COLOR_TRANSPARENT);
+    u32 pf = fb_cx->pack(fg), pb = opaque ? fb_cx->pack(bg) : 0;
+    int clip_x1 = cx + cw, clip_y1 = cy + ch;
+
+    for (int r = 0; r < 8; r++) {
+        int y0 = y + r * scale, y1 = y0 + scale;
+        if (y0 < cy) y0 = cy;
+        if (y1 > clip_y1) y1 = clip_y1;
+        if (y0 >= y1) continue;
+
+        for (int pass = 0; pass < (opaque ? 2 : 1); pass++) {
+            const u8 *runs = glyph_runs[pass ? (u8)~glyph[r] : glyph[r]];
+            u32 px = pass ? pb : pf;
+            for (int i = 0; i < runs[0]; i++) {
+                int x0 = x + runs[1 + 2*i] * scale;
+                int x1 = x0 + runs[2 + 2*i] * scale;
+                if (x0 < cx) x0 = cx;
+                if (x1 > clip_x1) x1 = clip_x1;
+                if (x0 >= x1) continue;
+                u8 *row = fb_row_ptr(x0, y0);
+                for (int yy = y0; yy < y1; yy++, row += fb_cx->target->pitch)
+                    fb_cx->span(row, x1 - x0, px);
             }
         }
     }
 }
+
+void fb_draw_char(int x, int y, char c, u32 fg, u32 bg, int scale) {
+    if (scale <= 0) return;
+    if (dl_active()) {
+        char s[2] = { c, '\0' };
+        fb_draw_string(x, y, s, fg, bg, scale);
+        return;
+    }
+    fb_damage_box(x, y, 8 * scale, 8 * scale);
+    glyph_draw(x, y, glyph_index(c), fg, bg, scale, glyph_slot_for(fg, bg, scale));
+}
+
+void fb_draw_string(int x, int y, const char *s, u32 fg, u32 bg, int scale) {
+    if (scale <= 0) return;
+    int n  = kstrlen(s);
+    int gs = 8 * scale;
+    if (n == 0) return;
+    FB_TRACE(TRACE_FB_TEXT, n * gs, gs);
+    if (dl_active() && (u32)n < DL_TEXT_BYTES) {
+        dl_reserve((u32)n + 1);
+        dl_cmd_t *c = dl_push(DL_TEXT, x, y, n * gs, gs, bg != COLOR_TRANSPARENT);
+        if (!c) return;
+        char *copy = dl_text + dl_text_used;
+        kmemcpy(copy, s, (size_t)n + 1);
+        dl_text_used += (u32)n + 1;
+        c->p[0] = x; c->p[1] = y; c->p[2] = scale;
+        c->color = fg; c->color2 = bg;
+        c->ptr = copy;
+        // Expand the glyphs now; the replay only reads the cache
+        glyph_slot_t *slot = glyph_slot_for(fg, bg, scale);
+        for (int i = 0; slot && i < n; i++)
+            glyph_pixels(slot, glyph_index(s[i]), scale);
+        return;
+    }
+
+    // One damage rect and one cache slot for the whole run
+    fb_damage_box(x, y, n * gs, gs);
+    glyph_slot_t *slot = glyph_slot_for(fg, bg, scale);
+    for (int i = 0; i < n && x < fb_cx->clip_x1; i++, x += gs)
+        glyph_draw(x, y, glyph_index(s[i]), fg, bg, scale, slot);
+}
+
+void fb_draw_logo(int start_x, int start_y, u32 color) {
+    fb_blit_mask(arctic_logo, LOGO_WIDTH, LOGO_HEIGHT, LOGO_STRIDE, start_x, start_y, color);
+}
+
 void fb_draw_loading_bar(int x, int y, int w, int h, int progress, u32 color) {
     fb_draw_rect(x - 2, y - 2, w + 4, h + 4, 0x555555, 1);
     int fill_w = (progress * w) / 100;
@@ -264,26 +1372,517 @@ void fb_draw_loading_bar(int x, int y, int w, int h, int progress, u32 color) {
         fb_fill_rect(x, y, fill_w, h, color);
     }
 }
-void fb_draw_line(int x0, int y0, int x1, int y1, u32 color) {
-    int dx =  abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
-    int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
-    int err = dx + dy, e2;
+// ============================================================
+// CIRCLES & RINGS
+// Each row is one or two horizontal spans. Row half-widths come
+// from an incremental midpoint walk (no per-pixel x*x + y*y test).
+// ============================================================
+static u32 isqrt(u32 v) {
+    u32 res = 0, bit = 1u << 30;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= res + bit) { v -= res + bit; res = (res >> 1) + bit; }
+        else res >>= 1;
+        bit >>= 2;
+    }
+    return res;
+}
 
-    for (;;) {
-        fb_put_pixel(x0, y0, color);
-        if (x0 == x1 && y0 == y1) break;
-        e2 = 2 * err;
-        if (e2 >= dy) { err += dy; x0 += sx; }
-        if (e2 <= dx) { err += dx; y0 += sy; }
+// hw[y] = largest x with x*x + y*y <= r*r, for y = 0..r
+static void circle_half_widths(int r, int *hw) {
+    int x = r, d = 0;                   // d = x*x + y*y - r*r
+    for (int y = 0; y <= r; y++) {
+        while (d > 0) { d -= 2 * x - 1; x--; }
+        hw[y] = x;
+        d += 2 * y + 1;
     }
 }
 
-void fb_fill_circle(int cx, int cy, int r, u32 color) {
-    for (int y = -r; y <= r; y++) {
-        for (int x = -r; x <= r; x++) {
-            if (x * x + y * y <= r * r) {
-                fb_put_pixel(cx + x, cy + y, color);
+
+// Solid pixels with r_in <= distance <= r_out (r_in <= 0: full disc)
+// Rings wholly beyond CIRCLE_MAX_R draw nothing: both half-width
+// tables stop there
+static void fill_ring_rows(int cx, int cy, int r_in, int r_out, u32 color) {
+    if (r_out < 0 || r_in > r_out || r_in > CIRCLE_MAX_R) return;
+    if (dl_active()) { dl_record_ring(cx, cy, r_in, r_out, color, false); return; }
+    if (r_out > CIRCLE_MAX_R) r_out = CIRCLE_MAX_R;
+    int hole = r_in - 1;                 // pixels inside this radius stay
+    if (hole > r_out) hole = r_out;
+    fb_damage_box(cx - r_out, cy - r_out, 2 * r_out + 1, 2 * r_out + 1);
+    circle_half_widths(r_out, fb_cx->hw_outer);
+    if (hole >= 0) circle_half_widths(hole, fb_cx->hw_inner);
+
+    u32 px = fb_cx->pack(color);
+    for (int y = 0; y <= r_out; y++) {
+        int o = fb_cx->hw_outer[y];
+        for (int side = 0; side < (y ? 2 : 1); side++) {
+            int row = side ? cy - y : cy + y;
+            if (hole >= 0 && y <= hole) {
+                int i = fb_cx->hw_inner[y];
+                fb_hspan(cx - o, cx - i - 1, row, px);
+                fb_hspan(cx + i + 1, cx + o, row, px);
+            } else {
+                fb_hspan(cx - o, cx + o, row, px);
+            }
+        }
+    }
+}
+
+// Coverage of pixel (x, y) by the ring, 0..256, in 1/16 px steps
+static u32 ring_coverage(int x, int y, int r_in, int r_out) {
+    int d16 = (int)isqrt((u32)(x * x + y * y) << 8);
+    int co = r_out * 16 + 8 - d16;
+    int ci = r_in > 0 ? d16 - (r_in * 16 - 8) : 16;
+    if (co > 16) co = 16;
+    if (ci > 16) ci = 16;
+    return (co <= 0 || ci <= 0) ? 0 : (u32)(co * ci);
+}
+
+// Anti-aliased ring: solid spans in the middle, coverage-blended
+// pixels only within a pixel of either edge
+static void fill_ring_rows_aa(int cx, int cy, int r_in, int r_out, u32 color) {
+    if (r_out < 0 || r_in > r_out || r_in > CIRCLE_MAX_R - 1) return;
+    if (dl_active()) { dl_record_ring(cx, cy, r_in, r_out, color, true); return; }
+    if (r_out > CIRCLE_MAX_R - 1) r_out = CIRCLE_MAX_R - 1;
+    if (r_in > r_out) r_in = r_out;     // keeps the squares below in range
+    int ext = r_out + 1;
+    fb_damage_box(cx - ext, cy - ext, 2 * ext + 1, 2 * ext + 1);
+
+    u32 px = fb_cx->pack(color);
+    for (int y = 0; y <= ext; y++) {
+        int yy = y * y;
+        // Per row, in |x|: (-, d] hole, (d, c] inner edge, (c, a] solid,
+        // (a, b] outer edge. Thin rings get c >= a and lose the solid part.
+        int a = (r_out - 1 >= y) ? (int)isqrt((u32)((r_out - 1) * (r_out - 1) - yy)) : -1;
+        int b = (int)isqrt((u32)(ext * ext - yy));
+        int c = -1, d = -1;
+        if (r_in > 0 && r_in + 1 >= y) c = (int)isqrt((u32)((r_in + 1) * (r_in + 1) - yy));
+        if (r_in > 1 && r_in - 1 >= y) d = (int)isqrt((u32)((r_in - 1) * (r_in - 1) - yy));
+
+        int solid0 = c + 1, solid1 = a;
+        int edge_lo[2] = { d + 1, (a > c ? a : c) + 1 };
+        int edge_hi[2] = { c, b };
+
+        for (int side = 0; side < (y ? 2 : 1); side++) {
+            int row = side ? cy - y : cy + y;
+            if (solid0 <= solid1) {
+                fb_hspan(cx - solid1, cx - solid0, row, px);
+                fb_hspan(cx + (solid0 ? solid0 : 1), cx + solid1, row, px);
+            }
+            for (int e = 0; e < 2; e++) {
+                for (int x = edge_lo[e]; x <= edge_hi[e]; x++) {
+                    u32 alpha = ring_coverage(x, y, r_in, r_out);
+                    fb_blend_pixel(cx - x, row, color, alpha);
+                    if (x) fb_blend_pixel(cx + x, row, color, alpha);
+                }
             }
         }
     }
-}
\ No newline at end of file
+}
+
+void fb_fill_circle(int cx, int cy, int r, u32 color) {
+    TRACE(TRACE_FB_CIRCLE, 2 * r, 2 * r);
+    fill_ring_rows(cx, cy, 0, r, color);
+}
+
+void fb_fill_circle_aa(int cx, int cy, int r, u32 color) {
+    TRACE(TRACE_FB_CIRCLE, 2 * r, 2 * r);
+    fill_ring_rows_aa(cx, cy, 0, r, color);
+}
+
+void fb_fill_ring(int cx, int cy, int r_inner, int r_outer, u32 color) {
+    fill_ring_rows(cx, cy, r_inner, r_outer, color);
+}
+
+void fb_fill_ring_aa(int cx, int cy, int r_inner, int r_outer, u32 color) {
+    fill_ring_rows_aa(cx, cy, r_inner, r_outer, color);
+}
+
+// ============================================================
+// LINES
+// Thin lines are clipped once, on the Bresenham step index, and
+// then walk raw back buffer offsets. Thick lines are filled as a
+// quad, one span per row.
+// ============================================================
+#define LINE_COORD_MAX  4095    // keeps all clip arithmetic in 32 bits
+#define LINE_MAX_THICK  64
+
+// a + d * num / den, rounded toward a; |num| <= |den|, den != 0.
+// 64-bit magnitudes, since the deltas of far-out ints overflow 32 bits.
+static int line_lerp(int a, i64 d, i64 num, i64 den) {
+    bool neg = (d < 0) ^ (num < 0) ^ (den < 0);
+    u64 ad = (u64)(d < 0 ? -d : d), an = (u64)(num < 0 ? -num : num);
+    u32 q = (u32)kdiv64(ad * an, (u32)(den < 0 ? -den : den), NULL);
+    return (int)(neg ? (i64)a - q : (i64)a + q);
+}
+
+static inline int line_outcode(int x, int y) {
+    return (x < -LINE_COORD_MAX) | (x > LINE_COORD_MAX) << 1 |
+           (y < -LINE_COORD_MAX) << 2 | (y > LINE_COORD_MAX) << 3;
+}
+
+// Cut the segment down to the square |x|, |y| <= LINE_COORD_MAX
+// (Cohen-Sutherland); false when none of it is inside. Far beyond
+// any screen, so moving the cut ends to whole pixels is invisible.
+static bool line_clip_range(int *x0, int *y0, int *x1, int *y1) {
+    for (int pass = 0; pass < 4; pass++) {
+        int c0 = line_outcode(*x0, *y0), c1 = line_outcode(*x1, *y1);
+        if (!(c0 | c1)) return true;
+        if (c0 & c1) return false;
+        int *px = c0 ? x0 : x1, *py = c0 ? y0 : y1;
+        int  qx = c0 ? *x1 : *x0, qy = c0 ? *y1 : *y0;
+        int  c  = c0 ? c0 : c1;
+        i64 dx = (i64)qx - *px, dy = (i64)qy - *py;
+        if (c & 3) {
+            int bound = (c & 1) ? -LINE_COORD_MAX : LINE_COORD_MAX;
+            *py = line_lerp(*py, dy, (i64)bound - *px, dx);
+            *px = bound;
+        } else {
+            int bound = (c & 4) ? -LINE_COORD_MAX : LINE_COORD_MAX;
+            *px = line_lerp(*px, dx, (i64)bound - *py, dy);
+            *py = bound;
+        }
+    }
+    return !(line_outcode(*x0, *y0) | line_outcode(*x1, *y1));
+}
+
+static void dl_record_line(int x0, int y0, int x1, int y1, u32 color, int thickness) {
+    dl_reserve(0);
+    int m = thickness > 1 ? thickness : 0;      // quad overhang, generously
+    int bx = (x0 < x1 ? x0 : x1) - m, by = (y0 < y1 ? y0 : y1) - m;
+    dl_cmd_t *c = dl_push(DL_LINE, bx, by, abs(x1 - x0) + 1 + 2 * m, abs(y1 - y0) + 1 + 2 * m, false);
+    if (!c) return;
+    c->p[0] = x0; c->p[1] = y0; c->p[2] = x1; c->p[3] = y1; c->p[4] = thickness;
+    c->color = color;
+}
+
+static inline int floor_div(int a, int b) {    // b > 0
+    int q = a / b;
+    return (a % b < 0) ? q - 1 : q;
+}
+
+// Plot n pixels: one major step each, a minor step whenever err wraps.
+// Inlined per pixel size so the store is a single move.
+static inline __attribute__((always_inline))
+void line_walk(u8 *p, int n, int step_major, int step_minor,
+               int err, int dm2, int dM2, u32 px, u32 bpp) {
+    for (;;) {
+        if (bpp == 4)      *(u32 *)p = px;
+        else if (bpp == 2) *(u16 *)p = (u16)px;
+        else { p[0] = (u8)px; p[1] = (u8)(px >> 8); p[2] = (u8)(px >> 16); }
+        if (--n == 0) break;
+        p += step_major;
+        err += dm2;
+        if (err >= dM2) { err -= dM2; p += step_minor; }
+    }
+}
+
+// Step i of a line moves i along the major axis and
+// k(i) = floor((2*i*dm + dM) / (2*dM)) along the minor one.
+// Clipping narrows [0, dM] to the steps inside the clip rect.
+void fb_draw_line(int x0, int y0, int x1, int y1, u32 color) {
+    if (fb_cx->bytespp == 0 || !line_clip_range(&x0, &y0, &x1, &y1)) return;
+    if (dl_active()) { dl_record_line(x0, y0, x1, y1, color, 1); return; }
+
+    int dx = x1 - x0, dy = y1 - y0;
+    bool steep = abs(dy) > abs(dx);
+    int M0 = steep ? y0 : x0, m0 = steep ? x0 : y0;
+    int dM = steep ? dy : dx, dm = steep ? dx : dy;
+    int sM = dM < 0 ? -1 : 1, sm = dm < 0 ? -1 : 1;
+    dM = abs(dM); dm = abs(dm);
+    int Mmin = steep ? fb_cx->clip_y0 : fb_cx->clip_x0, Mmax = (steep ? fb_cx->clip_y1 : fb_cx->clip_x1) - 1;
+    int mmin = steep ? fb_cx->clip_x0 : fb_cx->clip_y0, mmax = (steep ? fb_cx->clip_x1 : fb_cx->clip_y1) - 1;
+
+    // Steps whose major coordinate is inside the clip rect
+    int i0 = sM > 0 ? Mmin - M0 : M0 - Mmax;
+    int i1 = sM > 0 ? Mmax - M0 : M0 - Mmin;
+    // Minor offsets that are inside, turned into step bounds
+    int k0 = sm > 0 ? mmin - m0 : m0 - mmax;
+    int k1 = sm > 0 ? mmax - m0 : m0 - mmin;
+    if (k0 < 0)  k0 = 0;
+    if (k1 > dm) k1 = dm;
+    if (k0 > k1) return;
+    if (k0 > 0) {
+        int lo = (2 * dM * k0 - dM + 2 * dm - 1) / (2 * dm);
+        if (lo > i0) i0 = lo;
+    }
+    if (k1 < dm) {
+        int hi = (2 * dM * (k1 + 1) - dM - 1) / (2 * dm);
+        if (hi < i1) i1 = hi;
+    }
+    if (i0 < 0)  i0 = 0;
+    if (i1 > dM) i1 = dM;
+    if (i0 > i1) return;
+
+    int num = 2 * i0 * dm + dM;
+    int ks = dM ? num / (2 * dM) : 0;
+    int ke = dM ? (2 * i1 * dm + dM) / (2 * dM) : 0;
+    int Ms = M0 + sM * i0, ms = m0 + sm * ks;
+    int Me = M0 + sM * i1, me = m0 + sm * ke;
+    int xs = steep ? ms : Ms, ys = steep ? Ms : ms;
+    int xe = steep ? me : Me, ye = steep ? Me : me;
+
+    int bpp = (int)fb_cx->bytespp, pitch = (int)fb_cx->target->pitch;
+    int step_major = steep ? sM * pitch : sM * bpp;
+    int step_minor = steep ? sm * bpp : sm * pitch;
+    u8 *p = fb_row_ptr(xs, ys);
+    u32 px = fb_cx->pack(color);
+    int n = i1 - i0 + 1, err = num - 2 * dM * ks;
+    switch (bpp) {
+        case 4:  line_walk(p, n, step_major, step_minor, err, 2 * dm, 2 * dM, px, 4); break;
+        case 3:  line_walk(p, n, step_major, step_minor, err, 2 * dm, 2 * dM, px, 3); break;
+        default: line_walk(p, n, step_major, step_minor, err, 2 * dm, 2 * dM, px, 2); break;
+    }
+    fb_damage(xs < xe ? xs : xe, ys < ye ? ys : ye, abs(xe - xs) + 1, abs(ye - ys) + 1);
+}
+
+// One side of the thick-line quad, in 1/16 px. q and r split
+// 16*dx/dy so stepping whole rows never overflows.
+typedef struct { int xa, ya, yb, dx, dy, q, r; } line_edge_t;
+
+static void edge_setup(line_edge_t *e, int xa, int ya, int xb, int yb) {
+    if (ya > yb) { int t = xa; xa = xb; xb = t; t = ya; ya = yb; yb = t; }
+    e->xa = xa; e->ya = ya; e->yb = yb;
+    e->dx = xb - xa; e->dy = yb - ya;
+    if (e->dy) {
+        e->q = floor_div(16 * e->dx, e->dy);
+        e->r = 16 * e->dx - e->q * e->dy;
+    }
+}
+
+// x (1/16 px) where the edge crosses height yc, ya <= yc < yb
+static int edge_x(const line_edge_t *e, int yc) {
+    int t = yc - e->ya, n = t >> 4, o = t & 15;
+    return e->xa + n * e->q + floor_div(n * e->r + o * e->dx, e->dy);
+}
+
+// A line `thickness` pixels wide, centered on the segment; the
+// ends reach half a pixel past the endpoints, like thin lines.
+void fb_draw_thick_line(int x0, int y0, int x1, int y1, u32 color, int thickness) {
+    if (thickness <= 1) { fb_draw_line(x0, y0, x1, y1, color); return; }
+    if (fb_cx->bytespp == 0 || !line_clip_range(&x0, &y0, &x1, &y1)) return;
+    if (thickness > LINE_MAX_THICK) thickness = LINE_MAX_THICK;
+    if (dl_active()) { dl_record_line(x0, y0, x1, y1, color, thickness); return; }
+
+    int dx = x1 - x0, dy = y1 - y0;
+    int len4 = (int)isqrt((u32)(dx * dx + dy * dy) << 4);    // length * 4
+    if (len4 == 0) {
+        fb_fill_rect(x0 - thickness / 2, y0 - thickness / 2, thickness, thickness, color);
+        return;
+    }
+    // Half-width normal and half-pixel tangent, 1/16 px
+    int nx = -dy * thickness * 32 / len4, ny = dx * thickness * 32 / len4;
+    int tx = dx * 32 / len4, ty = dy * 32 / len4;
+    int ax = 16 * x0 + 8 - tx, ay = 16 * y0 + 8 - ty;
+    int bx = 16 * x1 + 8 + tx, by = 16 * y1 + 8 + ty;
+
+    line_edge_t edges[4];
+    edge_setup(&edges[0], ax + nx, ay + ny, bx + nx, by + ny);
+    edge_setup(&edges[1], bx + nx, by + ny, bx - nx, by - ny);
+    edge_setup(&edges[2], bx - nx, by - ny, ax - nx, ay - ny);
+    edge_setup(&edges[3], ax - nx, ay - ny, ax + nx, ay + ny);
+
+    // Rows whose pixel centers fall inside the quad
+    int ymin = edges[0].ya, ymax = edges[0].yb;
+    for (int i = 1; i < 4; i++) {
+        if (edges[i].ya < ymin) ymin = edges[i].ya;
+        if (edges[i].yb > ymax) ymax = edges[i].yb;
+    }
+    int row0 = -floor_div(8 - ymin, 16), row1 = -floor_div(8 - ymax, 16) - 1;
+    if (row0 < fb_cx->clip_y0) row0 = fb_cx->clip_y0;
+    if (row1 >= fb_cx->clip_y1) row1 = fb_cx->clip_y1 - 1;
+
+    u32 px = fb_cx->pack(color);
+    int dx0 = fb_cx->clip_x1, dx1 = -1, dy0 = -1, dy1 = -1;
+    for (int y = row0; y <= row1; y++) {
+        int yc = 16 * y + 8, xl = 0x7FFFFFFF, xr = -0x7FFFFFFF;
+        for (int i = 0; i < 4; i++) {
+            const line_edge_t *e = &edges[i];
+            if (yc < e->ya || yc >= e->yb) continue;
+            int x = edge_x(e, yc);
+            if (x < xl) xl = x;
+            if (x > xr) xr = x;
+        }
+        if (xl >= xr) continue;
+        int sx0 = -floor_div(8 - xl, 16), sx1 = -floor_div(8 - xr, 16) - 1;
+        if (sx0 < fb_cx->clip_x0) sx0 = fb_cx->clip_x0;
+        if (sx1 >= fb_cx->clip_x1) sx1 = fb_cx->clip_x1 - 1;
+        if (sx0 > sx1) continue;
+        fb_cx->span(fb_row_ptr(sx0, y), sx1 - sx0 + 1, px);
+        if (sx0 < dx0) dx0 = sx0;
+        if (sx1 > dx1) dx1 = sx1;
+        if (dy0 < 0) dy0 = y;
+        dy1 = y;
+    }
+    if (dy0 >= 0)
+        fb_damage(dx0, dy0, dx1 - dx0 + 1, dy1 - dy0 + 1);
+}
+
+// ============================================================
+// DISPLAY LIST - RENDERING
+// The screen is cut into DL_TILE x DL_TILE tiles and every command
+// is binned into the tiles its box touches. Per tile the bin is
+// walked back to front: a command whose part of the tile lies under
+// a later opaque one is dropped, and once an opaque command covers
+// the whole tile nothing older is looked at. What is left is drawn
+// front to back with the clip rect set to tile and box. With a
+// region, each tile is handled once per region rect it overlaps.
+// Tiles write disjoint pixels, and everything a tile changes lives
+// in its renderer: the drawing context (target, hooks, clip rect,
+// scratch) and the keep list. The rest is only read during a
+// replay: commands, bins, text, and the glyph and mask caches,
+// which are filled when commands are recorded and fall back to
+// uncached drawing on a miss. Damage is added before the tiles.
+// So tiles can be dealt out to one renderer per CPU.
+// ============================================================
+#define DL_RENDERERS    1       // one per CPU drawing tiles
+
+typedef struct {
+    fb_ctx_t cx;                // bound to the screen, clip = tile part
+    u16 keep[DL_MAX_CMDS];      // commands that survive culling
+} dl_renderer_t;
+
+static dl_renderer_t dl_renderers[DL_RENDERERS];
+static u16 dl_bin_count[DL_TILES_X * DL_TILES_Y];
+static u16 dl_bin_start[DL_TILES_X * DL_TILES_Y + 1];
+static u16 dl_bins[DL_MAX_BINNED];
+
+// out = a & b; false (out untouched) when they do not meet
+bool fb_rect_intersect(const fb_rect_t *a, const fb_rect_t *b, fb_rect_t *out) {
+    int x0 = a->x > b->x ? a->x : b->x;
+    int y0 = a->y > b->y ? a->y : b->y;
+    int x1 = a->x + a->w < b->x + b->w ? a->x + a->w : b->x + b->w;
+    int y1 = a->y + a->h < b->y + b->h ? a->y + a->h : b->y + b->h;
+    if (x0 >= x1 || y0 >= y1) return false;
+    out->x = x0; out->y = y0; out->w = x1 - x0; out->h = y1 - y0;
+    return true;
+}
+
+static inline bool rect_contains(const fb_rect_t *outer, const fb_rect_t *r) {
+    return r->x >= outer->x && r->y >= outer->y &&
+           r->x + r->w <= outer->x + outer->w && r->y + r->h <= outer->y + outer->h;
+}
+
+// Draw one command through the renderer's context, clipped to part
+static void dl_exec(dl_renderer_t *rd, const dl_cmd_t *c, const fb_rect_t *part) {
+    const int *p = c->p;
+    fb_ctx_clip(&rd->cx, part);
+    switch (c->op) {
+        case DL_FILL:    fb_fill_rect(c->box.x, c->box.y, c->box.w, c->box.h, c->color); break;
+        case DL_TEXT:    fb_draw_string(p[0], p[1], c->ptr, c->color, c->color2, p[2]); break;
+        case DL_LINE:    fb_draw_thick_line(p[0], p[1], p[2], p[3], c->color, p[4]); break;
+        case DL_MASK:    fb_blit_mask(c->ptr, p[0], p[1], p[2], p[3], p[4], c->color); break;
+        case DL_RESTORE: fb_restore(p[0], p[1], p[2], p[3], c->ptr); break;
+        case DL_BLIT:
+            blit_rows(&fb_screen, p[0], p[1], c->ptr, p[2], p[3], p[4], p[5], p[6], c->color);
+            break;
+        case DL_RING:
+            if (p[4]) fill_ring_rows_aa(p[0], p[1], p[2], p[3], c->color);
+            else      fill_ring_rows(p[0], p[1], p[2], p[3], c->color);
+            break;
+    }
+}
+
+// Visible commands of one tile, drawn in recording order
+static void dl_render_tile(dl_renderer_t *rd, const fb_rect_t *tile, const u16 *bin, int n) {
+    fb_rect_t occ[DL_OCCLUDERS], part;
+    int n_occ = 0, n_keep = 0;
+
+    for (int i = n - 1; i >= 0; i--) {
+        const dl_cmd_t *c = &dl_cmds[bin[i]];
+        if (!fb_rect_intersect(&c->box, tile, &part)) continue;
+        bool hidden = false;
+        for (int k = 0; k < n_occ && !hidden; k++)
+            hidden = rect_contains(&occ[k], &part);
+        if (hidden) continue;
+        rd->keep[n_keep++] = bin[i];
+        if (!c->opaque) continue;
+        if (rect_contains(&part, tile)) break;
+        if (n_occ < DL_OCCLUDERS) occ[n_occ++] = part;
+    }
+    while (n_keep--) {
+        const dl_cmd_t *c = &dl_cmds[rd->keep[n_keep]];
+        fb_rect_intersect(&c->box, tile, &part);
+        dl_exec(rd, c, &part);
+    }
+}
+
+static void dl_render(void) {
+    if (dl_count == 0 || dl_rendering) return;
+    dl_rendering = true;
+    bool recording = dl_recording;
+    dl_recording = false;
+    fb_ctx_t *prev = fb_cx;
+    dl_renderer_t *rd = &dl_renderers[0];
+    fb_bind(&rd->cx, &fb_screen);
+    fb_cx = &rd->cx;                    // primitives draw through it
+
+    fb_rect_t all = { 0, 0, fb_screen.width, fb_screen.height }, part;
+    const fb_rect_t *region = dl_region ? dl_region : &all;
+    int n_region = dl_region ? dl_region_n : 1;
+
+    // One damage rect per command and region rect, as drawing them
+    // directly would add
+    for (int i = 0; i < dl_count; i++)
+        for (int r = 0; r < n_region; r++)
+            if (fb_rect_intersect(&dl_cmds[i].box, &region[r], &part))
+                fb_damage_screen(part.x, part.y, part.w, part.h);
+
+    int tiles_x = (fb_screen.width  + DL_TILE - 1) / DL_TILE;
+    int tiles_y = (fb_screen.height + DL_TILE - 1) / DL_TILE;
+    int n_tiles = tiles_x * tiles_y;
+
+    // Count pass, then bins laid out back to back by prefix sum
+    u32 total = 0;
+    if (tiles_x > DL_TILES_X || tiles_y > DL_TILES_Y) n_tiles = 0;    // VRAM-only modes
+    if (n_tiles == 0) total = DL_MAX_BINNED + 1;
+    else kmemset(dl_bin_count, 0, (size_t)n_tiles * sizeof(u16));
+    for (int i = 0; i < dl_count && n_tiles; i++) {
+        const fb_rect_t *b = &dl_cmds[i].box;
+        int tx0 = b->x / DL_TILE, tx1 = (b->x + b->w - 1) / DL_TILE;
+        int ty0 = b->y / DL_TILE, ty1 = (b->y + b->h - 1) / DL_TILE;
+        for (int ty = ty0; ty <= ty1; ty++)
+            for (int tx = tx0; tx <= tx1; tx++)
+                dl_bin_count[ty * tiles_x + tx]++;
+        total += (u32)(tx1 - tx0 + 1) * (u32)(ty1 - ty0 + 1);
+    }
+
+    if (total > DL_MAX_BINNED) {
+        // Too many to bin: draw in order, each clipped to its own box
+        for (int i = 0; i < dl_count; i++)
+            for (int r = 0; r < n_region; r++)
+                if (fb_rect_intersect(&dl_cmds[i].box, &region[r], &part))
+                    dl_exec(rd, &dl_cmds[i], &part);
+    } else {
+        dl_bin_start[0] = 0;
+        for (int t = 0; t < n_tiles; t++) {
+            dl_bin_start[t + 1] = (u16)(dl_bin_start[t] + dl_bin_count[t]);
+            dl_bin_count[t] = 0;
+        }
+        for (int i = 0; i < dl_count; i++) {
+            const fb_rect_t *b = &dl_cmds[i].box;
+            int tx0 = b->x / DL_TILE, tx1 = (b->x + b->w - 1) / DL_TILE;
+            int ty0 = b->y / DL_TILE, ty1 = (b->y + b->h - 1) / DL_TILE;
+            for (int ty = ty0; ty <= ty1; ty++)
+                for (int tx = tx0; tx <= tx1; tx++) {
+                    int t = ty * tiles_x + tx;
+                    dl_bins[dl_bin_start[t] + dl_bin_count[t]++] = (u16)i;
+                }
+        }
+        for (int ty = 0; ty < tiles_y; ty++)
+            for (int tx = 0; tx < tiles_x; tx++) {
+                int t = ty * tiles_x + tx;
+                if (dl_bin_count[t] == 0) continue;
+                fb_rect_t tile = { tx * DL_TILE, ty * DL_TILE, DL_TILE, DL_TILE };
+                for (int r = 0; r < n_region; r++)
+                    if (fb_rect_intersect(&tile, &region[r], &part))
+                        dl_render_tile(rd, &part, &dl_bins[dl_bin_start[t]], dl_bin_count[t]);
+            }
+    }
+
+    dl_count = 0;
+    dl_text_used = 0;
+    fb_cx = prev;
+    dl_recording = recording;
+    dl_rendering = false;
+}
@@ -0,0 +1,135 @@
+#include "../include/kernel.h"
+
+// High Precision Event Timer: only its free-running main counter is
+// used, as a clocksource. The register block is located through the
+// ACPI "HPET" table (RSDP in the BIOS area -> RSDT -> HPET).
+
+#define HPET_REG_CAP        0x000   // [31:0] caps, [63:32] period in fs
+#define HPET_REG_CONFIG     0x010
+#define HPET_REG_COUNTER    0x0F0
+#define HPET_CAP_64BIT      (1u << 13)
+#define HPET_CONFIG_ENABLE  0x1
+#define HPET_MAX_PERIOD_FS  100000000u  // spec: at most 100 ns per count
+
+#define ACPI_BIOS_START     0xE0000
+#define ACPI_BIOS_END       0x100000
+
+typedef struct {
+    char sig[8];                    // "RSD PTR "
+    u8   checksum;
+    char oem_id[6];
+    u8   revision;
+    u32  rsdt_addr;
+} __attribute__((packed)) acpi_rsdp_t;
+
+typedef struct {
+    char sig[4];
+    u32  length;
+    u8   revision;
+    u8   checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    u32  oem_revision;
+    u32  creator_id;
+    u32  creator_revision;
+} __attribute__((packed)) acpi_header_t;
+
+typedef struct {
+    acpi_header_t hdr;
+    u32 block_id;
+    u8  space_id;                   // 0 = memory
+    u8  bit_width;
+    u8  bit_offset;
+    u8  access_size;
+    u64 address;
+    u8  number;
+    u16 min_tick;
+    u8  protection;
+} __attribute__((packed)) acpi_hpet_t;
+
+static volatile u8 *hpet_regs = 0;
+static u32  hpet_period = 0;
+static bool hpet_64bit = false;
+static u32  hpet_hi, hpet_last_lo;  // software upper half of a 32-bit counter
+
+static bool acpi_checksum(const void *p, u32 len) {
+    const u8 *b = p;
+    u8 sum = 0;
+    while (len--) sum += *b++;
+    return sum == 0;
+}
+
+// ACPI tables may sit past the RAM paging maps: map before reading
+static const acpi_header_t *acpi_map_table(u32 addr) {
+    if (!paging_map(addr, sizeof(acpi_header_t), PAGE_CACHE_WB)) return NULL;
+    const acpi_header_t *h = (const acpi_header_t *)addr;
+    if (h->length < sizeof(*h) || !paging_map(addr, h->length, PAGE_CACHE_WB)) return NULL;
+    return acpi_checksum(h, h->length) ? h : NULL;
+}
+
+static const acpi_header_t *acpi_find_table(const char *sig) {
+    const acpi_rsdp_t *rsdp = NULL;
+    for (u32 p = ACPI_BIOS_START; p < ACPI_BIOS_END && !rsdp; p += 16)
+        if (kstrncmp((const char *)p, "RSD PTR ", 8) == 0 && acpi_checksum((const void *)p, 20))
+            rsdp = (const acpi_rsdp_t *)p;
+    if (!rsdp) return NULL;
+
+    const acpi_header_t *rsdt = acpi_map_table(rsdp->rsdt_addr);
+    if (!rsdt) return NULL;
+    const u32 *entry = (const u32 *)(rsdt + 1);
+    u32 n = (rsdt->length - sizeof(*rsdt)) / 4;
+    for (u32 i = 0; i < n; i++) {
+        const acpi_header_t *h = acpi_map_table(entry[i]);
+        if (h && kstrncmp(h->sig, sig, 4) == 0) return h;
+    }
+    return NULL;
+}
+
+static u32 hpet_read32(u32 reg) {
+    return *(volatile u32 *)(hpet_regs + reg);
+}
+
+static void hpet_write32(u32 reg, u32 val) {
+    *(volatile u32 *)(hpet_regs + reg) = val;
+}
+
+bool hpet_init(void) {
+    const acpi_hpet_t *t = (const acpi_hpet_t *)acpi_find_table("HPET");
+    if (!t || t->space_id != 0 || t->address == 0 || t->address >= 0x100000000ull)
+        return false;
+    hpet_regs = paging_map_mmio((u32)t->address, 1024, PAGE_CACHE_UC);
+    if (!hpet_regs) return false;
+
+    u32 cap = hpet_read32(HPET_REG_CAP);
+    hpet_period = hpet_read32(HPET_REG_CAP + 4);
+    if (hpet_period == 0 || hpet_period > HPET_MAX_PERIOD_FS) {
+        hpet_regs = 0;
+        return false;
+    }
+    hpet_64bit = (cap & HPET_CAP_64BIT) != 0;
+    hpet_write32(HPET_REG_CONFIG, hpet_read32(HPET_REG_CONFIG) | HPET_CONFIG_ENABLE);
+    hpet_last_lo = hpet_read32(HPET_REG_COUNTER);
+    return true;
+}
+
+// A 64-bit counter is read as two halves, again if the upper one
+// moved in between. A 32-bit one is widened here, which holds as
+// long as it is read at least once per wrap (minutes).
+u64 hpet_read(void) {
+    u32 hi, lo;
+    if (hpet_64bit) {
+        do {
+            hi = hpet_read32(HPET_REG_COUNTER + 4);
+            lo = hpet_read32(HPET_REG_COUNTER);
+        } while (hi != hpet_read32(HPET_REG_COUNTER + 4));
+        return ((u64)hi << 32) | lo;
+    }
+    lo = hpet_read32(HPET_REG_COUNTER);
+    if (lo < hpet_last_lo) hpet_hi++;
+    hpet_last_lo = lo;
+    return ((u64)hpet_hi << 32) | lo;
+}
+
+u32 hpet_period_fs(void) {
+    return hpet_period;
+}
@@ -22,6 +22,7 @@ static volatile int kbd_tail = 0;  // read (kernel)
 
 static void buffer_push(char c) {
     int next = (kbd_head + 1) % KBD_BUFFER_SIZE;
+    TRACE(TRACE_KEY, (u8)c, next == kbd_tail);
     if (next != kbd_tail) {
         kbd_buffer[kbd_head] = c;
         kbd_head = next;
@@ -135,9 +136,11 @@ bool keyboard_has_char(void) {
     return kbd_head != kbd_tail;
 }
 
+// Sleeps in the timer queue: due timers (taskbar clock) keep
+// running, and the key check and halt cannot miss a wakeup
 char keyboard_getchar(void) {
     while (!keyboard_has_char())
-        __asm__ volatile("hlt");
+        ktimer_wait(KTIME_NEVER, true);
     char c = kbd_buffer[kbd_tail];
     kbd_tail = (kbd_tail + 1) % KBD_BUFFER_SIZE;
     return c;
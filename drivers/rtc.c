@@ -16,16 +16,29 @@
 #define RTC_STATUS_C  0x0C
 
 static rtc_time_t current_time;
-static bool rtc_updated = false;
+static volatile u32 rtc_updates = 0;
 
+// Index + data access must not be split by the IRQ8 handler,
+// which reads the CMOS itself
 static u8 cmos_read(u8 reg) {
+    u32 flags;
+    __asm__ volatile ("pushf; pop %0; cli" : "=r"(flags));
     outb(CMOS_ADDR, reg | 0x80); // bit 7 = disable NMI during read
-    return inb(CMOS_DATA);
+    u8 v = inb(CMOS_DATA);
+    __asm__ volatile ("push %0; popf" : : "r"(flags) : "memory", "cc");
+    return v;
+}
+
+static void cmos_write(u8 reg, u8 val) {
+    u32 flags;
+    __asm__ volatile ("pushf; pop %0; cli" : "=r"(flags));
+    outb(CMOS_ADDR, reg | 0x80);
+    outb(CMOS_DATA, val);
+    __asm__ volatile ("push %0; popf" : : "r"(flags) : "memory", "cc");
 }
 
 static bool rtc_is_updating(void) {
-    outb(CMOS_ADDR, RTC_STATUS_A);
-    return (inb(CMOS_DATA) & 0x80) != 0;
+    return (cmos_read(RTC_STATUS_A) & 0x80) != 0;
 }
 
 static u8 bcd_to_bin(u8 val) {
@@ -80,14 +93,44 @@ void rtc_read(rtc_time_t *t) {
     }
 
     if (t->weekday == 0) t->weekday = 7;
-    rtc_updated = true;
 }
 
-void rtc_handler(void) {
+// Periodic interrupt at 32768 >> (rate - 1) Hz, rate 3..15
+// (8192..2 Hz): the fastest that does not exceed hz. Returns the
+// rate set, 0 when hz is 0 (periodic interrupt off).
+u32 rtc_set_periodic(u32 hz) {
+    u8 b = cmos_read(RTC_STATUS_B);
+    if (hz < 2) {
+        cmos_write(RTC_STATUS_B, b & ~RTC_IRQ_PERIODIC);
+        return 0;
+    }
+    u32 rate = 3;
+    while (rate < 15 && (32768u >> (rate - 1)) > hz) rate++;
+    cmos_write(RTC_STATUS_A, (cmos_read(RTC_STATUS_A) & 0xF0) | rate);
+    cmos_write(RTC_STATUS_B, b | RTC_IRQ_PERIODIC);
+    return 32768u >> (rate - 1);
+}
+
+u8 rtc_handler(void) {
     // Read Status C to acknowledge interrupt
     outb(CMOS_ADDR, RTC_STATUS_C);
-    inb(CMOS_DATA);
-    rtc_read(&current_time);
+    u8 cause = inb(CMOS_DATA);
+    if (cause & RTC_IRQ_UPDATE) {
+        rtc_read(&current_time);
+        rtc_updates++;
+    }
+    return cause & (RTC_IRQ_PERIODIC | RTC_IRQ_UPDATE);
+}
+
+void rtc_get_time(rtc_time_t *t) {
+    u32 flags;
+    __asm__ volatile ("pushf; pop %0; cli" : "=r"(flags));
+    *t = current_time;
+    __asm__ volatile ("push %0; popf" : : "r"(flags) : "memory", "cc");
+}
+
+u32 rtc_get_updates(void) {
+    return rtc_updates;
 }
 
 const char *rtc_weekday_str(u8 wd) {
@@ -0,0 +1,47 @@
+#include "../include/kernel.h"
+
+// 16550 UART on COM1, polled, 115200 8N1, output only. Used for
+// dumps too large for the screen (profiles, traces); with no UART
+// present every write is dropped.
+
+#define COM1            0x3F8
+#define UART_DATA       0
+#define UART_IER        1
+#define UART_FCR        2
+#define UART_LCR        3
+#define UART_MCR        4
+#define UART_LSR        5
+#define UART_LSR_THRE   0x20        // transmit holding register empty
+#define UART_SPIN       100000      // polls before a write is dropped
+
+static bool serial_ok = false;
+
+bool serial_init(void) {
+    outb(COM1 + UART_IER, 0x00);    // no interrupts
+    outb(COM1 + UART_LCR, 0x80);    // DLAB: divisor follows
+    outb(COM1 + UART_DATA, 1);      // 115200 / 1
+    outb(COM1 + UART_IER, 0);
+    outb(COM1 + UART_LCR, 0x03);    // 8N1
+    outb(COM1 + UART_FCR, 0xC7);    // FIFOs on, cleared, 14-byte trigger
+
+    // Loopback: a byte sent must come straight back
+    outb(COM1 + UART_MCR, 0x1E);
+    outb(COM1 + UART_DATA, 0xAE);
+    serial_ok = inb(COM1 + UART_DATA) == 0xAE;
+    outb(COM1 + UART_MCR, 0x0F);    // normal mode, DTR/RTS/OUT1/OUT2
+    return serial_ok;
+}
+
+bool serial_present(void) {
+    return serial_ok;
+}
+
+void serial_putc(char c) {
+    if (!serial_ok) return;
+    for (u32 i = 0; i < UART_SPIN && !(inb(COM1 + UART_LSR) & UART_LSR_THRE); i++);
+    outb(COM1 + UART_DATA, (u8)c);
+}
+
+void serial_write(const char *s) {
+    while (*s) serial_putc(*s++);
+}
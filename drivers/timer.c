@@ -3,41 +3,84 @@
 #define PIT_CHANNEL0 0x40
 #define PIT_COMMAND  0x43
 #define PIT_BASE_FREQ 1193180
+#define PIT_MAX_COUNT 0xFFFF            // longest one-shot: ~55 ms
 
 static volatile u32 ticks = 0;
-static u32 ticks_per_ms = 0;
-
-// Called by irq_handler when IRQ0 fires
-static void pit_tick(void) {
-    ticks++;
-}
+static u32 pit_reload = 0;
+static bool pit_oneshot = false;
 
 void timer_init(u32 freq) {
     u32 divisor = PIT_BASE_FREQ / freq;
-    outb(PIT_COMMAND, 0x36);
+    pit_reload = divisor;
+    // Mode 2 (rate generator): the count falls by one per input
+    // clock, so a latched count tells how far into a tick we are
+    outb(PIT_COMMAND, 0x34);
     outb(PIT_CHANNEL0, divisor & 0xFF);
     outb(PIT_CHANNEL0, (divisor >> 8) & 0xFF);
-    ticks_per_ms = freq / 1000;
-    if (ticks_per_ms == 0) ticks_per_ms = 1;
 }
 
+// Called by irq_handler when IRQ0 fires: periodic ticks, or the
+// one-shot deadline armed by timer_arm()
+void timer_irq(void) {
+    ticks++;
+}
+
+// IRQ0s so far; one per ms only while the PIT is periodic
 u32 timer_get_ticks(void) {
     return ticks;
 }
 
-// Called by IRQ0 handler
-void timer_tick_internal(void) {
-    pit_tick();
+u32 timer_get_ms(void) {
+    return (u32)kdiv64(ktime_ns(), 1000000, NULL);
+}
+
+u32 timer_get_reload(void) {
+    return pit_reload;
+}
+
+// PIT input clocks (PIT_INPUT_HZ) since timer_init: whole ticks plus
+// what the current one has counted down. Lags by a tick if IRQ0 is
+// pending while interrupts are off; ktime_ns() never goes backwards.
+// Only meaningful while the PIT is periodic.
+u64 timer_read_pit(void) {
+    u32 flags;
+    __asm__ volatile ("pushf; pop %0; cli" : "=r"(flags));
+    outb(PIT_COMMAND, 0x00);            // latch channel 0
+    u32 count = inb(PIT_CHANNEL0);
+    count |= (u32)inb(PIT_CHANNEL0) << 8;
+    u32 t = ticks;
+    __asm__ volatile ("push %0; popf" : : "r"(flags) : "memory", "cc");
+    if (count > pit_reload) count = pit_reload;
+    return (u64)t * pit_reload + (pit_reload - count);
+}
+
+// Stop the periodic tick: from now on IRQ0 fires only when armed.
+// Only once ktime_ns() runs off another counter (TSC or HPET).
+void timer_set_oneshot(void) {
+    pit_oneshot = true;
+    timer_arm(PIT_MAX_COUNT * 1000000000ull / PIT_INPUT_HZ);
+}
+
+bool timer_is_oneshot(void) {
+    return pit_oneshot;
+}
+
+// One IRQ0 in `ns` nanoseconds (mode 0, interrupt on terminal count),
+// replacing any armed before. Longer delays are cut to PIT_MAX_COUNT;
+// the caller re-arms when it wakes early. No-op while periodic.
+void timer_arm(u64 ns) {
+    if (!pit_oneshot) return;
+    u32 count = PIT_MAX_COUNT;
+    if (ns < 60000000)                  // 60 ms is past PIT_MAX_COUNT
+        count = (u32)kdiv64(ns * PIT_INPUT_HZ + 999999999, 1000000000, NULL);
+    if (count > PIT_MAX_COUNT) count = PIT_MAX_COUNT;
+    if (count == 0) count = 1;
+    outb(PIT_COMMAND, 0x30);
+    outb(PIT_CHANNEL0, count & 0xFF);
+    outb(PIT_CHANNEL0, (count >> 8) & 0xFF);
 }
 
+// Halts until `ms` have passed; timers due meanwhile still run
 void timer_sleep(u32 ms) {
-    if (ms == 0) {
-        // Called from irq_handler - just increment ticks
-        ticks++;
-        return;
-    }
-    u32 target = ticks + ms * ticks_per_ms;
-    while (ticks < target) {
-        __asm__ volatile("hlt");
-    }
+    ktimer_wait(ktime_ns() + (u64)ms * 1000000, false);
 }
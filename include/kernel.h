@@ -55,6 +55,26 @@ typedef struct {
     u8  framebuffer_type;
 } __attribute__((packed)) multiboot_info_t;
 
+#define MB1_FLAG_MEM     (1 << 0)   // mem_lower/mem_upper valid
+#define MB1_FLAG_CMDLINE (1 << 2)
+#define MB1_FLAG_MODS    (1 << 3)
+#define MB1_FLAG_MMAP    (1 << 6)
+#define MMAP_AVAILABLE  1           // memory map type of usable RAM
+
+typedef struct {
+    u32 size;           // of the rest of the entry
+    u64 addr;
+    u64 len;
+    u32 type;
+} __attribute__((packed)) mb1_mmap_entry_t;
+
+typedef struct {
+    u32 mod_start;
+    u32 mod_end;
+    u32 cmdline;
+    u32 reserved;
+} __attribute__((packed)) mb1_module_t;
+
 // --- Multiboot 2 ---
 typedef struct {
     u32 total_size;
@@ -78,18 +98,79 @@ typedef struct {
     u16 reserved;
 } __attribute__((packed)) mb2_tag_framebuffer_t;
 
+#define MB2_TAG_CMDLINE  1
+#define MB2_TAG_MODULE   3
+#define MB2_TAG_MEMINFO  4
+#define MB2_TAG_MMAP     6
+
+typedef struct {
+    u32 type;       // = 3
+    u32 size;
+    u32 mod_start;
+    u32 mod_end;
+} __attribute__((packed)) mb2_tag_module_t;    // followed by the cmdline
+
+typedef struct {
+    u32 type;       // = 4
+    u32 size;
+    u32 mem_lower;  // KiB
+    u32 mem_upper;
+} __attribute__((packed)) mb2_tag_meminfo_t;
+
+typedef struct {
+    u32 type;       // = 6
+    u32 size;
+    u32 entry_size;
+    u32 entry_version;
+} __attribute__((packed)) mb2_tag_mmap_t;      // followed by the entries
+
+typedef struct {
+    u64 addr;
+    u64 len;
+    u32 type;
+    u32 reserved;
+} __attribute__((packed)) mb2_mmap_entry_t;
+
 // ============================================================
 // FRAMEBUFFER
 // ============================================================
+// Largest mode the RAM back buffer can shadow
+#define FB_MAX_WIDTH   1280
+#define FB_MAX_HEIGHT  1024
+
 typedef struct {
-    u32 *addr;
+    u32 *addr;          // linear framebuffer (VRAM)
     u32  pitch;
     u32  width;
     u32  height;
     u8   bpp;
     u32  pitch_pixels;
+    u8  *back;          // RAM back buffer, same layout as addr (== addr if none)
+    u32  vram_size;     // bytes of VRAM the driver may use (>= pitch * height)
+    u32  mode_id;       // bumped on every mode change
 } framebuffer_t;
 
+typedef struct {
+    int x, y, w, h;
+} fb_rect_t;
+
+bool fb_rect_intersect(const fb_rect_t *a, const fb_rect_t *b, fb_rect_t *out);
+
+// Pixel formats of drawing surfaces
+#define FB_FORMAT_NONE      0
+#define FB_FORMAT_RGB565    1   // 16 bpp
+#define FB_FORMAT_RGB888    2   // 24 bpp, bytes B, G, R
+#define FB_FORMAT_XRGB8888  3   // 32 bpp, top byte unused
+#define FB_FORMAT_ARGB8888  4   // 32 bpp, top byte alpha (0 = transparent)
+
+// Something fb_* primitives can draw into: the screen or a RAM bitmap
+typedef struct {
+    int  width, height;
+    u32  pitch;         // bytes per row
+    u32  format;        // FB_FORMAT_*
+    u8  *pixels;
+} fb_surface_t;
+
 extern framebuffer_t fb;
 
 // ============================================================
@@ -112,6 +193,9 @@ extern framebuffer_t fb;
 #define COLOR_ARCTIC_WIN  0x000D1F3C
 #define COLOR_TEXT_BRIGHT 0x00E0F0FF
 
+// Background for fb_draw_char/fb_draw_string that leaves pixels untouched
+#define COLOR_TRANSPARENT 0xFF000000
+
 // ============================================================
 // ASM FUNCTION DECLARATIONS
 // ============================================================
@@ -119,6 +203,8 @@ extern void outb(u16 port, u8 val);
 extern u8   inb(u16 port);
 extern void outw(u16 port, u16 val);
 extern u16  inw(u16 port);
+extern void outl(u16 port, u32 val);
+extern u32  inl(u16 port);
 extern void enable_interrupts(void);
 extern void disable_interrupts(void);
 extern void idt_load(void *idt_ptr);
@@ -128,31 +214,195 @@ extern void gdt_load(void *gdt_ptr);
 // MODULE DECLARATIONS
 // ============================================================
 
+// CPU (cpuid, MSRs, memory types)
+#define CPUID_EDX_PSE   3
+#define CPUID_EDX_TSC   4
+#define CPUID_EDX_MSR   5
+#define CPUID_EDX_MTRR  12
+#define CPUID_EDX_PAT   16
+#define CPUID_EDX_MMX   23
+#define CPUID_EDX_FXSR  24
+#define CPUID_EDX_SSE   25
+#define CPUID_EDX_SSE2  26
+
+void cpu_cpuid(u32 leaf, u32 *eax, u32 *ebx, u32 *ecx, u32 *edx);
+bool cpu_has(u32 leaf1_edx_bit);
+u64  cpu_rdmsr(u32 msr);
+void cpu_wrmsr(u32 msr, u64 val);
+bool cpu_paging_enabled(void);
+bool cpu_enable_sse(void);
+bool cpu_sse_enabled(void);
+int  mtrr_set_wc(u32 base, u32 size);
+bool pat_init(void);
+
+// Physical memory (buddy allocator over page frames)
+#define PAGE_SIZE      4096
+#define PMM_MAX_ORDER  10       // largest block: 2^10 pages = 4 MiB
+
+typedef struct {
+    u32 usable_pages;           // RAM the memory map calls available
+    u32 free_pages;
+    u32 kernel_bytes;           // loaded image incl. .bss
+    u32 free_blocks[PMM_MAX_ORDER + 1];
+} pmm_stats_t;
+
+void pmm_init(u32 magic, void *mbi);
+u32  pmm_alloc_pages(u32 order);             // physical address, 0 if none
+void pmm_free_pages(u32 addr, u32 order);
+void pmm_get_stats(pmm_stats_t *st);
+u32  pmm_phys_end(void);
+
+// Paging: identity map, 4 MiB pages where possible, per-range cache type
+#define PAGE_CACHE_WB  0x00     // PAT entry 0
+#define PAGE_CACHE_WC  0x08     // PWT: entry 1, set to WC by pat_init
+#define PAGE_CACHE_UC  0x18     // PCD | PWT: entry 3
+
+typedef struct {
+    u32 large_pages;            // 4 MiB
+    u32 small_pages;            // 4 KiB
+    u32 tables;
+} paging_stats_t;
+
+bool  paging_init(void);
+bool  paging_map(u32 phys, u32 size, u32 cache);
+void *paging_map_mmio(u32 phys, u32 size, u32 cache);  // NULL if out of memory
+void  paging_unmap(u32 addr, u32 size);
+void  paging_get_stats(paging_stats_t *st);
+
+// Kernel heap: object caches over one-page slabs, and kmalloc
+// rounding up to power-of-two caches (16..1024 bytes, pages above)
+typedef struct kmem_cache kmem_cache_t;
+
+typedef struct {
+    const char *name;
+    u32 size;                   // object size (0: page-sized blocks)
+    u32 active, total;          // objects in use / room in its slabs
+    u32 pages;
+    u32 allocs, frees;
+} kmem_stats_t;
+
+void slab_init(void);
+kmem_cache_t *kmem_cache_create(const char *name, u32 size);   // NULL if too big
+void *kmem_cache_alloc(kmem_cache_t *c);                        // NULL if out of memory
+void  kmem_cache_free(kmem_cache_t *c, void *obj);
+void *kmalloc(size_t size);
+void  kfree(void *ptr);
+bool  kmem_cache_stats(int i, kmem_stats_t *st);
+
+// Arenas: bump allocation, freed all at once by reset/release
+typedef struct arena_chunk arena_chunk_t;
+
+typedef struct {
+    arena_chunk_t *chunks;      // newest first
+    u8 *cur, *end;              // free space in the newest block
+    u32 used;                   // bytes handed out
+    u32 pages;                  // pages held
+} arena_t;
+
+void *arena_alloc(arena_t *a, u32 size);    // NULL if out of memory
+void *arena_zalloc(arena_t *a, u32 size);
+void  arena_reset(arena_t *a);
+void  arena_release(arena_t *a);
+
 // GDT/IDT
 void gdt_init(void);
 void idt_init(void);
 
 // Interrupts
+typedef struct {
+    u32 edi, esi, ebp, esp, ebx, edx, ecx, eax;    // pusha
+    u32 eip, cs, eflags;                            // pushed by the CPU
+} irq_frame_t;
+
 void pic_init(void);
-void irq_handler(int irq_num);
+void irq_handler(int irq_num, const irq_frame_t *frame);
 void isr_handler(int isr_num);
+void kernel_panic(const char *msg);     // panic screen, never returns
 
 // Framebuffer / graphics
 void fb_init(multiboot_info_t *mbi);
 void fb_init_mb2(mb2_info_t *mb2);
 void fb_clear(u32 color);
 void fb_put_pixel(int x, int y, u32 color);
+void fb_pixels_begin(void);  // batch fb_put_pixel damage into one box...
+void fb_pixels_end(void);    // ...reported here
 void fb_fill_rect(int x, int y, int w, int h, u32 color);
 void fb_draw_rect(int x, int y, int w, int h, u32 color, int thickness);
 void fb_draw_char(int x, int y, char c, u32 fg, u32 bg, int scale);
 void fb_draw_string(int x, int y, const char *s, u32 fg, u32 bg, int scale);
 void fb_draw_line(int x0, int y0, int x1, int y1, u32 color);
+void fb_draw_thick_line(int x0, int y0, int x1, int y1, u32 color, int thickness);
 void fb_fill_circle(int cx, int cy, int r, u32 color);
+void fb_fill_circle_aa(int cx, int cy, int r, u32 color);
+void fb_fill_ring(int cx, int cy, int r_inner, int r_outer, u32 color);
+void fb_fill_ring_aa(int cx, int cy, int r_inner, int r_outer, u32 color);
+void fb_present(void);   // copy damaged areas of the back buffer to VRAM
+bool fb_has_damage(void);
+u32  fb_snapshot(int x, int y, int w, int h, void *dst, u32 cap);
+void fb_restore(int x, int y, int w, int h, const void *src);
+void fb_scroll_rect(int x, int y, int w, int h, int dy);
+void fb_list_begin(void);   // queue screen drawing into a tiled display list
+void fb_list_end(void);     // draw it, skipping whatever later opaque drawing hides
+void fb_list_begin_region(const fb_rect_t *rects, int n);  // ... drawn only inside rects
+void fb_set_mode(u32 *vram, u32 width, u32 height, u32 pitch, u8 bpp);
+bool fb_enable_flip(void (*show_page)(int page));   // two pages in VRAM
+bool fb_flipping(void);
+void fb_enable_write_combining(void);
+const char *fb_cache_mode(void);
+u32  fb_measure_bandwidth(void);   // VRAM write speed in MB/s
+
+// Surfaces (NULL = the screen)
+void fb_surface_init(fb_surface_t *s, int w, int h, u32 format, void *pixels);
+u32  fb_surface_size(int w, int h, u32 format);
+fb_surface_t *fb_set_target(fb_surface_t *s);   // returns the previous target
+void fb_set_clip(const fb_rect_t *r);            // NULL = whole target
+void fb_blit(fb_surface_t *dst, int dx, int dy, const fb_surface_t *src);
+void fb_blit_rect(fb_surface_t *dst, int dx, int dy, const fb_surface_t *src,
+                  int sx, int sy, int w, int h);
+void fb_blit_key(fb_surface_t *dst, int dx, int dy, const fb_surface_t *src,
+                 int sx, int sy, int w, int h, u32 key);
+void fb_blit_alpha(fb_surface_t *dst, int dx, int dy, const fb_surface_t *src,
+                   int sx, int sy, int w, int h, u32 alpha);
 
 // Splash Screen & Utilities
 void fb_draw_logo(int start_x, int start_y, u32 color);
+void fb_blit_mask(const u8 *mask, int w, int h, int stride, int x, int y, u32 color);
 void fb_draw_loading_bar(int x, int y, int w, int h, int progress, u32 color);
 
+// Bochs/QEMU display adapter (-vga std)
+bool bga_init(void);
+bool bga_present(void);
+bool bga_set_mode(u32 width, u32 height, u32 bpp);
+
+// Window manager: stacked windows over the desktop, each drawn only
+// where it is visible
+#define WM_MAX_WINDOWS  8
+// A visible region is the frame cut by the frames above it. Pieces
+// only split along those frames' edges: at most 2 * 7 + 1 bands per
+// axis inside the frame, so never more than 15 x 15 pieces.
+#define WM_MAX_CLIP     ((2 * WM_MAX_WINDOWS - 1) * (2 * WM_MAX_WINDOWS - 1))
+
+typedef struct wm_window wm_window_t;
+struct wm_window {
+    fb_rect_t   frame;
+    const char *title;
+    void      (*paint)(wm_window_t *w);    // redraw all of it (the WM clips)
+    fb_rect_t   clip[WM_MAX_CLIP];         // visible parts, screen coordinates
+    int         n_clip;
+    bool        open;
+};
+
+void wm_set_background(void (*paint)(void));
+wm_window_t *wm_open(int x, int y, int w, int h, const char *title,
+                     void (*paint)(wm_window_t *w));
+void wm_close(wm_window_t *w);
+void wm_set_frame(wm_window_t *w, int x, int y, int width, int height);
+void wm_raise(wm_window_t *w);
+void wm_repaint(const fb_rect_t *r);        // NULL = whole screen
+void wm_begin(wm_window_t *w);              // draw into w's visible parts...
+void wm_end(void);                          // ...until here
+bool wm_visible(const wm_window_t *w, const fb_rect_t *r);  // r entirely uncovered
+
 // PS/2 Mouse
 void mouse_init(void);
 void mouse_handler(void);
@@ -168,6 +418,12 @@ bool keyboard_has_char(void);
 void keyboard_handler(void);
 const char *keyboard_get_buffer(void);
 
+// Serial port (COM1, polled output)
+bool serial_init(void);
+bool serial_present(void);
+void serial_putc(char c);
+void serial_write(const char *s);
+
 // RTC
 typedef struct {
     u8 second;
@@ -181,19 +437,139 @@ typedef struct {
 
 void rtc_init(void);
 void rtc_read(rtc_time_t *t);
-void rtc_handler(void);
+void rtc_get_time(rtc_time_t *t);   // last time latched by the IRQ8 handler
+u32  rtc_get_updates(void);         // bumped once per RTC update interrupt
+u32  rtc_set_periodic(u32 hz);      // IRQ8 at a power of two <= hz; 0: off
+#define RTC_IRQ_PERIODIC 0x40
+#define RTC_IRQ_UPDATE   0x10
+u8   rtc_handler(void);             // the RTC_IRQ_* causes it acknowledged
 const char *rtc_weekday_str(u8 wd);
 const char *rtc_month_str(u8 m);
 
 // Timer
+#define TIMER_HZ 1000      // must divide 1000
+#define PIT_INPUT_HZ 1193182
+
 void timer_init(u32 freq);
 u32  timer_get_ticks(void);
+u32  timer_get_ms(void);
+u32  timer_get_reload(void);        // PIT input clocks per tick
+u64  timer_read_pit(void);          // PIT input clocks since boot
+void timer_irq(void);
+void timer_set_oneshot(void);       // tickless: IRQ0 only when armed
+bool timer_is_oneshot(void);
+void timer_arm(u64 ns);             // one-shot IRQ0 in ns (capped ~55 ms)
 void timer_sleep(u32 ms);
 
+// HPET (found through the ACPI tables)
+bool hpet_init(void);
+u64  hpet_read(void);
+u32  hpet_period_fs(void);          // femtoseconds per count
+
+// Clocksources: the best of invariant TSC, HPET and PIT, calibrated
+// at boot, behind one monotonic nanosecond clock
+void        clocksource_init(void);
+u64         ktime_ns(void);
+const char *clocksource_name(void);
+u32         clocksource_khz(void);
+u32         clocksource_tsc_khz(void);  // calibrated TSC rate, 0 if none
+
+// Raw time stamp counter (no serialization)
+static inline u64 rdtsc(void) {
+    u32 lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((u64)hi << 32) | lo;
+}
+
+// Timer queue: callbacks at ktime_ns() deadlines, run by ktimer_wait()
+// outside interrupt context while the CPU otherwise sleeps
+#define KTIME_NEVER 0xFFFFFFFFFFFFFFFFull
+
+int  ktimer_add(u64 at, void (*fn)(void *arg), void *arg);  // -1 if full
+void ktimer_cancel(int id);
+bool ktimer_wait(u64 until, bool wake_on_key);  // false: woken by a key
+
+// Frame scheduler: update/draw callbacks at a fixed rate
+typedef struct {
+    u32 hz;
+    u32 frames;         // frames run
+    u32 idle;           // ... that left nothing to present
+    u32 dropped;        // frames skipped because one ran late
+    u32 over_budget;    // frames that took longer than budget_us
+    u32 budget_us;
+    u32 last_us;
+    u32 max_us;
+} frame_stats_t;
+
+void frame_init(void);
+void frame_set_rate(u32 hz);
+int  frame_add(bool (*update)(u32 now_ms), void (*draw)(void));  // -1 if full
+void frame_remove(int id);
+void frame_wait(bool wake_on_key);
+void frame_get_stats(frame_stats_t *out);
+extern arena_t frame_scratch;   // temporaries, reset before every frame
+
+// Sampling profiler (RTC IRQ8), dumped over COM1
+typedef struct {
+    bool running;
+    bool stacks_on;
+    u32 hz;
+    u32 samples;
+    u32 outside;        // samples not in kernel text
+    u32 stacks;         // call stacks kept
+    u32 dropped;        // ... and lost to a full buffer
+} prof_stats_t;
+
+u32  prof_start(u32 hz, bool stacks);   // rate set, 0 on failure
+void prof_stop(void);
+void prof_sample(const irq_frame_t *frame);
+void prof_get_stats(prof_stats_t *st);
+bool prof_dump(void);                   // false without a serial port
+
+// Event trace: TSC-stamped records from static tracepoints into a
+// per-CPU ring, dumped over COM1
+enum {
+    TRACE_IRQ_ENTER,        // a = irq
+    TRACE_IRQ_EXIT,
+    TRACE_KEY,              // a = char, b = 1 if the buffer was full
+    TRACE_APP_START,        // a = desktop icon
+    TRACE_APP_EXIT,
+    TRACE_FB_FILL,          // a = w, b = h
+    TRACE_FB_TEXT,
+    TRACE_FB_CIRCLE,
+    TRACE_FB_PRESENT,       // b = damage rects
+    TRACE_FB_PRESENTED,
+    TRACE_EVENT_COUNT
+};
+
+typedef struct {
+    bool running;
+    u32 events;             // records held
+    u32 lost;               // ... overwritten by newer ones
+} trace_stats_t;
+
+extern bool trace_on;
+void trace_emit(u32 event, u32 a, u32 b);
+#define TRACE(ev, a, b) \
+    do { if (__builtin_expect(trace_on, 0)) trace_emit((ev), (u32)(a), (u32)(b)); } while (0)
+
+bool trace_start(void);     // false without a calibrated TSC or memory
+void trace_stop(void);
+void trace_get_stats(trace_stats_t *st);
+bool trace_dump(void);      // false without a serial port
+
+// Benchmarks (results go out one line at a time)
+void bench_memory(void (*out)(const char *line));
+int  bench_add(const char *name, void (*fn)(u32 arg), u32 arg);  // -1 if full
+void bench_remove(int id);
+void bench_run(const char *filter, void (*out)(const char *line)); // name prefix
+#define QEMU_EXIT_PORT 0xF4     // isa-debug-exit: QEMU exits with (value << 1) | 1
+
 // Desktop
 void desktop_init(void);
 void desktop_run(void);
 void desktop_draw(void);
+extern arena_t app_arena;       // the running app's memory, released when it exits
 
 // Apps
 void app_clock_run(void);
@@ -208,9 +584,22 @@ int    kstrcmp(const char *a, const char *b);
 int    kstrncmp(const char *a, const char *b, int n);
 void  *kmemset(void *ptr, int val, size_t n);
 void  *kmemcpy(void *dst, const void *src, size_t n);
+void  *kmemmove(void *dst, const void *src, size_t n);
+void  *kmemset32(void *ptr, u32 val, size_t count);
 void   kitoa(i32 val, char *buf, int base);
 void   kutoa(u32 val, char *buf, int base);
+u64    kdiv64(u64 n, u32 d, u32 *rem);
 int    katoi(const char *s);
 void   ksprintf(char *buf, const char *fmt, ...);
 
+// Bulk fill/copy kernels (libc/blit.c), SSE2 or scalar.
+// fill32 counts are in dwords; stream_* use non-temporal stores
+// for data that will not be read back soon (VRAM, huge clears).
+extern void (*blit_fill32)(void *dst, u32 val, size_t count);
+extern void (*blit_stream_fill32)(void *dst, u32 val, size_t count);
+extern void (*blit_copy)(void *dst, const void *src, size_t n);
+extern void (*blit_stream_copy)(void *dst, const void *src, size_t n);
+void        blit_init(void);
+const char *blit_impl_name(void);
+
 #endif // KERNEL_H
\ No newline at end of file
@@ -3,8 +3,9 @@
 
 #define LOGO_WIDTH 100
 #define LOGO_HEIGHT 100
+#define LOGO_STRIDE ((LOGO_WIDTH + 7) / 8)   // bytes per row, MSB = leftmost pixel
 
 // Deklaracja: "Ta tablica istnieje gdzieś w projekcie"
-extern unsigned char arctic_logo[];
+extern const unsigned char arctic_logo[LOGO_HEIGHT * LOGO_STRIDE];
 
 #endif
\ No newline at end of file
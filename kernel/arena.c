@@ -0,0 +1,82 @@
+#include "../include/kernel.h"
+
+// ============================================================
+// ARENAS
+// Bump allocation out of page blocks from the buddy allocator.
+// Nothing is freed on its own: an arena is reset or released as a
+// whole, which returns its few blocks without touching the objects
+// inside. Each new block is at least twice the previous one, so a
+// growing arena needs only a handful of them.
+// ============================================================
+#define ARENA_MIN_ORDER  2          // first block: 16 KiB
+#define ARENA_ALIGN      16
+
+struct arena_chunk {
+    arena_chunk_t *next;            // older, smaller blocks
+    u32 order;
+};
+
+#define CHUNK_HDR  ((sizeof(arena_chunk_t) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+static bool arena_grow(arena_t *a, u32 size) {
+    u32 order = a->chunks ? a->chunks->order + 1 : ARENA_MIN_ORDER;
+    if (order > PMM_MAX_ORDER) order = PMM_MAX_ORDER;
+    while (order <= PMM_MAX_ORDER && ((u32)PAGE_SIZE << order) - CHUNK_HDR < size) order++;
+    if (order > PMM_MAX_ORDER) return false;
+
+    u32 page = pmm_alloc_pages(order);
+    if (!page) return false;
+    arena_chunk_t *c = (arena_chunk_t *)page;
+    c->next  = a->chunks;
+    c->order = order;
+    a->chunks = c;
+    a->cur    = (u8 *)page + CHUNK_HDR;
+    a->end    = (u8 *)page + ((u32)PAGE_SIZE << order);
+    a->pages += 1u << order;
+    return true;
+}
+
+// size bytes, ARENA_ALIGN aligned, uninitialized; NULL if out of memory
+void *arena_alloc(arena_t *a, u32 size) {
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (!a->chunks || (u32)(a->end - a->cur) < size)
+        if (!arena_grow(a, size)) return NULL;
+    void *p = a->cur;
+    a->cur  += size;
+    a->used += size;
+    return p;
+}
+
+void *arena_zalloc(arena_t *a, u32 size) {
+    void *p = arena_alloc(a, size);
+    if (p) kmemset(p, 0, size);
+    return p;
+}
+
+static void arena_free_chunks(arena_chunk_t *c) {
+    while (c) {
+        arena_chunk_t *next = c->next;
+        pmm_free_pages((u32)c, c->order);
+        c = next;
+    }
+}
+
+// Forget every allocation but keep the newest (largest) block, so
+// an arena refilled to the same size each time settles on one block
+void arena_reset(arena_t *a) {
+    arena_chunk_t *c = a->chunks;
+    if (!c) return;
+    arena_free_chunks(c->next);
+    c->next  = NULL;
+    a->cur   = (u8 *)c + CHUNK_HDR;
+    a->used  = 0;
+    a->pages = 1u << c->order;
+}
+
+// Give every block back to the page allocator
+void arena_release(arena_t *a) {
+    arena_free_chunks(a->chunks);
+    a->chunks = NULL;
+    a->cur = a->end = NULL;
+    a->used = a->pages = 0;
+}
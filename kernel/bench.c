@@ -0,0 +1,274 @@
+#include "../include/kernel.h"
+
+// ============================================================
+// MEMORY BENCHMARKS
+// Every copy and fill variant runs on 1 KiB (cache resident),
+// 64 KiB (L2 sized) and one full frame of the current mode,
+// repeated for BENCH_MS, timed with ktime_ns(). Results are in MB/s; the
+// byte and dword loops are the baselines the rep string and
+// SSE2 paths are measured against.
+// ============================================================
+#define BENCH_MS       50
+#define BENCH_BATCH    (64 * 1024)  // bytes per timer check, at least
+
+typedef struct {
+    const char *name;               // NULL: the blit kernel's own name
+    void (*fn)(u8 *dst, u8 *src, u32 n);
+} bench_variant_t;
+
+static void copy_bytes(u8 *dst, u8 *src, u32 n) {
+    while (n--) *dst++ = *src++;
+}
+
+static void copy_dwords(u8 *dst, u8 *src, u32 n) {
+    u32 *d = (u32 *)dst, *s = (u32 *)src;
+    for (n /= 4; n; n--) *d++ = *s++;
+}
+
+static void copy_rep(u8 *dst, u8 *src, u32 n)  { kmemcpy(dst, src, n); }
+static void copy_move(u8 *dst, u8 *src, u32 n) { (void)src; kmemmove(dst + 16, dst, n - 16); }
+static void copy_blit(u8 *dst, u8 *src, u32 n) { blit_copy(dst, src, n); }
+
+static void fill_bytes(u8 *dst, u8 *src, u32 n) {
+    (void)src;
+    while (n--) *dst++ = 0x5A;
+}
+
+static void fill_dwords(u8 *dst, u8 *src, u32 n) {
+    (void)src;
+    u32 *d = (u32 *)dst;
+    for (n /= 4; n; n--) *d++ = 0x00A0EFFF;
+}
+
+static void fill_rep(u8 *dst, u8 *src, u32 n)   { (void)src; kmemset(dst, 0x5A, n); }
+static void fill_rep32(u8 *dst, u8 *src, u32 n) { (void)src; kmemset32(dst, 0x00A0EFFF, n / 4); }
+static void fill_blit(u8 *dst, u8 *src, u32 n)  { (void)src; blit_fill32(dst, 0x00A0EFFF, n / 4); }
+
+static const bench_variant_t copy_variants[] = {
+    { "byte",  copy_bytes },
+    { "dword", copy_dwords },
+    { "rep",   copy_rep },
+    { "move",  copy_move },         // overlapping, copied backwards
+    { NULL,    copy_blit },
+};
+
+static const bench_variant_t fill_variants[] = {
+    { "byte",  fill_bytes },
+    { "dword", fill_dwords },
+    { "rep",   fill_rep },
+    { "rep32", fill_rep32 },
+    { NULL,    fill_blit },
+};
+
+static u32 bench_rate(const bench_variant_t *v, u8 *dst, u8 *src, u32 n) {
+    u32 reps = n < BENCH_BATCH ? BENCH_BATCH / n : 1;
+    u64 t0 = ktime_ns(), ns;
+    u64 bytes = 0;
+    do {
+        for (u32 i = 0; i < reps; i++) v->fn(dst, src, n);
+        bytes += (u64)reps * n;
+    } while ((ns = ktime_ns() - t0) < BENCH_MS * 1000000ull);
+    // MB/s = bytes / 2^20 / (ns / 10^9); ns stays well within 32 bits
+    return (u32)kdiv64((bytes * 1000000000ull) >> 20, (u32)ns, NULL);
+}
+
+// Name padded to name_w columns, then each value in 8
+static void bench_row(char *buf, const char *name, int name_w, const u32 *vals, int n) {
+    int len = kstrlen(name);
+    kmemcpy(buf, name, len);
+    while (len < name_w) buf[len++] = ' ';
+    buf[len] = '\0';
+    for (int i = 0; i < n; i++) {
+        char num[12];
+        kutoa(vals[i], num, 10);
+        int pad = 8 - kstrlen(num);
+        while (pad-- > 0) buf[len++] = ' ';
+        kstrcpy(buf + len, num);
+        len += kstrlen(num);
+    }
+}
+
+static void bench_table(void (*out)(const char *line), const char *title,
+                        const bench_variant_t *v, int nv, u8 *dst, u8 *src, const u32 *sizes) {
+    char buf[80];
+    ksprintf(buf, "%s      1K     64K   frame  (MB/s)", title);
+    out(buf);
+    for (int i = 0; i < nv; i++) {
+        u32 mbs[3];
+        for (int s = 0; s < 3; s++)
+            mbs[s] = bench_rate(&v[i], dst, src, sizes[s]);
+        bench_row(buf, v[i].name ? v[i].name : blit_impl_name(), 8, mbs, 3);
+        out(buf);
+    }
+}
+
+// Runs for about a second and a half; the buffers come from the
+// page allocator and go back afterwards. Frames past 4 MiB are
+// measured on their first 4 MiB.
+void bench_memory(void (*out)(const char *line)) {
+    u32 frame = fb.pitch * fb.height;
+    u32 order = 0;
+    while (order < PMM_MAX_ORDER && ((u32)PAGE_SIZE << order) < frame) order++;
+    if (frame > ((u32)PAGE_SIZE << order)) frame = (u32)PAGE_SIZE << order;
+    if (frame < BENCH_BATCH) frame = BENCH_BATCH;
+    if (order < 4) order = 4;       // room for the 64 KiB runs
+
+    u32 dst = pmm_alloc_pages(order);
+    u32 src = pmm_alloc_pages(order);
+    if (!dst || !src) {
+        out("Not enough memory for the benchmark buffers");
+    } else {
+        u32 sizes[3] = { 1024, 64 * 1024, frame & ~3u };
+        char buf[64];
+        ksprintf(buf, "frame = %u KiB", frame / 1024);
+        out(buf);
+        kmemset((u8 *)src, 0x3C, frame);
+        bench_table(out, "copy    ", copy_variants, 5, (u8 *)dst, (u8 *)src, sizes);
+        bench_table(out, "fill    ", fill_variants, 5, (u8 *)dst, (u8 *)src, sizes);
+    }
+    if (dst) pmm_free_pages(dst, order);
+    if (src) pmm_free_pages(src, order);
+}
+
+// ============================================================
+// MICROBENCHMARKS
+// A registry of small hot paths, each one call of fn(arg). After
+// BENCH_WARMUP untimed calls every call is timed on its own with the
+// TSC, BENCH_SAMPLES times, less the cost of timing an empty call;
+// the report is min / median / p99 in TSC cycles. Interrupts stay
+// on, so the p99 shows what they cost. Drawing goes to the back
+// buffer like any other drawing; whoever runs the suite repaints.
+// Apps add their own entries while they run (bench_add).
+// ============================================================
+#define BENCH_WARMUP    8
+#define BENCH_SAMPLES   201         // odd: the median is a sample
+#define BENCH_EXTRA     8
+#define BENCH_NAME_W    24
+
+typedef struct {
+    const char *name;
+    void (*fn)(u32 arg);
+    u32 arg;
+} bench_t;
+
+static u8 *bench_src, *bench_dst;   // 64 KiB each while the suite runs
+
+static void b_nothing(u32 arg)    { (void)arg; }
+static void b_clear(u32 arg)      { (void)arg; fb_clear(COLOR_ARCTIC_BG); }
+static void b_fill_rect(u32 n)    { fb_fill_rect(40, 40, (int)n, (int)n, COLOR_ARCTIC_WIN); }
+static void b_circle(u32 r)       { fb_fill_circle(300, 300, (int)r, COLOR_ARCTIC_ACC); }
+static void b_circle_aa(u32 r)    { fb_fill_circle_aa(300, 300, (int)r, COLOR_ARCTIC_ACC); }
+static void b_scroll(u32 arg)     { (void)arg; fb_scroll_rect(40, 40, 640, 400, -16); }
+static void b_memcpy(u32 n)       { kmemcpy(bench_dst, bench_src, n); }
+static void b_memset(u32 n)       { kmemset(bench_dst, 0x5A, n); }
+
+static void b_string(u32 bg) {
+    fb_draw_string(40, 40, "The quick brown fox jumps over the lazy", COLOR_TEXT_BRIGHT, bg, 1);
+}
+
+static void b_sprintf(u32 arg) {
+    char buf[64];
+    ksprintf(buf, "%s %u/%u 0x%x %d", "frame", arg, 60u, 0xBEEFu, -42);
+}
+
+static const bench_t bench_builtin[] = {
+    { "fb_clear",               b_clear,     0 },
+    { "fb_fill_rect 16x16",     b_fill_rect, 16 },
+    { "fb_fill_rect 64x64",     b_fill_rect, 64 },
+    { "fb_fill_rect 256x256",   b_fill_rect, 256 },
+    { "fb_draw_string 39ch",    b_string,    COLOR_ARCTIC_BG },
+    { "fb_draw_string transp",  b_string,    COLOR_TRANSPARENT },
+    { "fb_fill_circle r32",     b_circle,    32 },
+    { "fb_fill_circle r128",    b_circle,    128 },
+    { "fb_fill_circle_aa r64",  b_circle_aa, 64 },
+    { "fb_scroll_rect 640x400", b_scroll,    0 },
+    { "kmemcpy 4K",             b_memcpy,    4096 },
+    { "kmemcpy 64K",            b_memcpy,    65536 },
+    { "kmemset 4K",             b_memset,    4096 },
+    { "ksprintf",               b_sprintf,   12345 },
+};
+
+static bench_t bench_extra[BENCH_EXTRA];
+
+// Register fn(arg) under name (kept by reference); -1 if full
+int bench_add(const char *name, void (*fn)(u32 arg), u32 arg) {
+    for (int i = 0; i < BENCH_EXTRA; i++) {
+        if (bench_extra[i].fn) continue;
+        bench_extra[i].name = name;
+        bench_extra[i].fn   = fn;
+        bench_extra[i].arg  = arg;
+        return i;
+    }
+    return -1;
+}
+
+void bench_remove(int id) {
+    if (id >= 0 && id < BENCH_EXTRA)
+        bench_extra[id].fn = NULL;
+}
+
+// Sorted cycle counts of BENCH_SAMPLES single calls
+static void bench_sample(const bench_t *b, u32 *cyc) {
+    for (int i = 0; i < BENCH_WARMUP; i++) b->fn(b->arg);
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        u64 t0 = rdtsc();
+        b->fn(b->arg);
+        u64 d = rdtsc() - t0;
+        cyc[i] = d > 0xFFFFFFFFull ? 0xFFFFFFFF : (u32)d;
+    }
+    for (int i = 1; i < BENCH_SAMPLES; i++) {
+        u32 v = cyc[i];
+        int j = i;
+        for (; j > 0 && cyc[j - 1] > v; j--) cyc[j] = cyc[j - 1];
+        cyc[j] = v;
+    }
+}
+
+static void bench_report(const bench_t *b, u32 overhead, void (*out)(const char *line)) {
+    u32 cyc[BENCH_SAMPLES];
+    bench_sample(b, cyc);
+    u32 v[3] = { cyc[0], cyc[BENCH_SAMPLES / 2], cyc[(BENCH_SAMPLES - 1) * 99 / 100] };
+    for (int i = 0; i < 3; i++) v[i] = v[i] > overhead ? v[i] - overhead : 0;
+    char buf[80];
+    bench_row(buf, b->name, BENCH_NAME_W, v, 3);
+    out(buf);
+}
+
+static bool bench_match(const bench_t *b, const char *filter) {
+    return !filter || !*filter || kstrncmp(b->name, filter, kstrlen(filter)) == 0;
+}
+
+// Every registered benchmark whose name starts with filter (NULL or
+// "": all of them). Takes a second or two.
+void bench_run(const char *filter, void (*out)(const char *line)) {
+    if (!cpu_has(CPUID_EDX_TSC)) {
+        out("The benchmarks need the TSC");
+        return;
+    }
+    u32 buf = pmm_alloc_pages(5);   // 128 KiB
+    if (!buf) {
+        out("Not enough memory for the benchmark buffers");
+        return;
+    }
+    bench_src = (u8 *)buf;
+    bench_dst = (u8 *)buf + 65536;
+    kmemset(bench_src, 0x3C, 65536);
+
+    const bench_t empty = { "", b_nothing, 0 };
+    u32 cyc[BENCH_SAMPLES];
+    bench_sample(&empty, cyc);
+    u32 overhead = cyc[0];
+
+    char line[80];
+    ksprintf(line, "TSC %u kHz, timing overhead %u cycles (subtracted)",
+        clocksource_tsc_khz(), overhead);
+    out(line);
+    out("benchmark                    min  median     p99  (cycles)");
+    for (u32 i = 0; i < sizeof(bench_builtin) / sizeof(bench_builtin[0]); i++)
+        if (bench_match(&bench_builtin[i], filter))
+            bench_report(&bench_builtin[i], overhead, out);
+    for (int i = 0; i < BENCH_EXTRA; i++)
+        if (bench_extra[i].fn && bench_match(&bench_extra[i], filter))
+            bench_report(&bench_extra[i], overhead, out);
+    pmm_free_pages(buf, 5);
+}
@@ -0,0 +1,117 @@
+#include "../include/kernel.h"
+
+// ============================================================
+// CLOCKSOURCES
+// A clocksource is a free-running counter plus the scale that
+// turns its counts into nanoseconds: ns = counts * mult >> shift,
+// done in 32x32 multiplies so no 64-bit division is ever needed.
+// The PIT is always there; HPET has its period in a register; the
+// TSC is calibrated against whole PIT ticks. The best one found
+// becomes the source of ktime_ns().
+// ============================================================
+#define CAL_TICKS            100    // TSC calibration window (~100 ms)
+#define CPUID_EXT_POWER      0x80000007
+#define CPUID_INVARIANT_TSC  (1u << 8)
+
+typedef struct {
+    const char *name;
+    u64 (*read)(void);
+    u32 mult, shift;
+    u32 khz;
+} clocksource_t;
+
+static clocksource_t cs_pit  = { "pit",  timer_read_pit, 0, 0, 0 };
+static clocksource_t cs_hpet = { "hpet", hpet_read,      0, 0, 0 };
+static clocksource_t cs_tsc  = { "tsc",  rdtsc,          0, 0, 0 };
+
+static clocksource_t *cs_cur = NULL;
+static u64 cs_base_counts;          // cs_cur->read() when it was selected
+static u64 cs_base_ns;              // ktime_ns() at that moment
+static u64 cs_last_ns;
+
+// Scale for a counter that advances `counts` in `ns` nanoseconds:
+// the largest shift (<= 32) that still leaves mult in 32 bits
+static void cs_set_rate(clocksource_t *cs, u32 counts, u32 ns) {
+    u32 shift = 32;
+    u64 mult;
+    while ((mult = kdiv64((u64)ns << shift, counts, NULL)) > 0xFFFFFFFFull) shift--;
+    cs->mult  = (u32)mult;
+    cs->shift = shift;
+    cs->khz   = (u32)kdiv64((u64)counts * 1000000, ns, NULL);
+}
+
+static u64 cs_to_ns(const clocksource_t *cs, u64 counts) {
+    u32 hi = (u32)(counts >> 32), lo = (u32)counts;
+    return (((u64)hi * cs->mult) << (32 - cs->shift)) + (((u64)lo * cs->mult) >> cs->shift);
+}
+
+static void cs_select(clocksource_t *cs) {
+    u64 now = ktime_ns();
+    cs_base_counts = cs->read();
+    cs_base_ns = now;
+    cs_cur = cs;
+}
+
+// Nanoseconds since timer_init() (in whole PIT ticks until
+// clocksource_init() picks a counter); never goes backwards
+u64 ktime_ns(void) {
+    if (!cs_cur) return (u64)timer_get_ticks() * (1000000000 / TIMER_HZ);
+    u64 ns = cs_base_ns + cs_to_ns(cs_cur, cs_cur->read() - cs_base_counts);
+    if (ns < cs_last_ns) ns = cs_last_ns;
+    cs_last_ns = ns;
+    return ns;
+}
+
+// TSC counts over CAL_TICKS PIT ticks, both ends taken right after
+// a tick so the interrupt latency cancels out
+static u32 tsc_calibrate(void) {
+    u32 t = timer_get_ticks();
+    while (timer_get_ticks() == t) __asm__ volatile("hlt");
+    u64 c0 = rdtsc();
+    t = timer_get_ticks();
+    while (timer_get_ticks() - t < CAL_TICKS) __asm__ volatile("hlt");
+    return (u32)(rdtsc() - c0);
+}
+
+static bool tsc_invariant(void) {
+    u32 max_ext, edx;
+    cpu_cpuid(0x80000000, &max_ext, NULL, NULL, NULL);
+    if (max_ext < CPUID_EXT_POWER) return false;
+    cpu_cpuid(CPUID_EXT_POWER, NULL, NULL, NULL, &edx);
+    return (edx & CPUID_INVARIANT_TSC) != 0;
+}
+
+// Needs the PIT ticking with interrupts on, and paging (HPET MMIO).
+// Preference: invariant TSC, HPET, any TSC, PIT. Unless time still
+// comes from PIT ticks, the PIT then stops ticking and only fires
+// when the timer queue arms it.
+void clocksource_init(void) {
+    cs_set_rate(&cs_pit, PIT_INPUT_HZ, 1000000000);
+    cs_select(&cs_pit);
+
+    bool hpet = hpet_init();
+    if (hpet) cs_set_rate(&cs_hpet, 1000000, hpet_period_fs());   // 10^6 counts
+
+    bool tsc = cpu_has(CPUID_EDX_TSC);
+    if (tsc) {
+        u32 tick_ns = (u32)kdiv64((u64)timer_get_reload() * 1000000000, PIT_INPUT_HZ, NULL);
+        cs_set_rate(&cs_tsc, tsc_calibrate(), CAL_TICKS * tick_ns);
+    }
+
+    if (tsc && tsc_invariant()) cs_select(&cs_tsc);
+    else if (hpet)              cs_select(&cs_hpet);
+    else if (tsc)               cs_select(&cs_tsc);
+    if (cs_cur != &cs_pit) timer_set_oneshot();
+}
+
+const char *clocksource_name(void) {
+    return cs_cur ? cs_cur->name : "none";
+}
+
+u32 clocksource_khz(void) {
+    return cs_cur ? cs_cur->khz : 0;
+}
+
+u32 clocksource_tsc_khz(void) {
+    return cs_tsc.khz;
+}
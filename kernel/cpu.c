@@ -0,0 +1,216 @@
+// ============================================================
+// ArcticOS - CPU feature detection, MSRs, MTRR/PAT setup
+// ============================================================
+
+#include "../include/kernel.h"
+
+#define MSR_MTRRCAP        0x0FE
+#define MSR_MTRR_DEF_TYPE  0x2FF
+#define MSR_MTRR_PHYSBASE0 0x200
+#define MSR_MTRR_PHYSMASK0 0x201
+#define MSR_PAT            0x277
+
+#define MTRR_TYPE_UC       0x00
+#define MTRR_TYPE_WC       0x01
+#define MTRR_VALID         (1u << 11)
+#define MTRR_DEF_ENABLE    (1u << 11)
+
+#define CR0_MP             (1u << 1)
+#define CR0_EM             (1u << 2)
+#define CR0_CD             (1u << 30)
+#define CR0_NW             (1u << 29)
+#define CR0_PG             (1u << 31)
+#define CR4_PGE            (1u << 7)
+#define CR4_OSFXSR         (1u << 9)
+#define CR4_OSXMMEXCPT     (1u << 10)
+
+// ============================================================
+// CPUID / MSR PRIMITIVES
+// ============================================================
+void cpu_cpuid(u32 leaf, u32 *eax, u32 *ebx, u32 *ecx, u32 *edx) {
+    u32 a, b, c, d;
+    __asm__ volatile ("cpuid"
+        : "=a"(a), "=b"(b), "=c"(c), "=d"(d)
+        : "a"(leaf), "c"(0));
+    if (eax) *eax = a;
+    if (ebx) *ebx = b;
+    if (ecx) *ecx = c;
+    if (edx) *edx = d;
+}
+
+u64 cpu_rdmsr(u32 msr) {
+    u32 lo, hi;
+    __asm__ volatile ("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((u64)hi << 32) | lo;
+}
+
+void cpu_wrmsr(u32 msr, u64 val) {
+    __asm__ volatile ("wrmsr" : : "c"(msr), "a"((u32)val), "d"((u32)(val >> 32)));
+}
+
+static u32 read_cr0(void) {
+    u32 v;
+    __asm__ volatile ("mov %%cr0, %0" : "=r"(v));
+    return v;
+}
+
+static void write_cr0(u32 v) {
+    __asm__ volatile ("mov %0, %%cr0" : : "r"(v) : "memory");
+}
+
+bool cpu_paging_enabled(void) {
+    return (read_cr0() & CR0_PG) != 0;
+}
+
+bool cpu_has(u32 leaf1_edx_bit) {
+    u32 edx;
+    cpu_cpuid(1, NULL, NULL, NULL, &edx);
+    return (edx >> leaf1_edx_bit) & 1;
+}
+
+static u32 cpu_phys_bits(void) {
+    u32 max_ext, bits;
+    cpu_cpuid(0x80000000, &max_ext, NULL, NULL, NULL);
+    if (max_ext < 0x80000008) return 36;
+    cpu_cpuid(0x80000008, &bits, NULL, NULL, NULL);
+    return bits & 0xFF;
+}
+
+// ============================================================
+// SSE STATE
+// ============================================================
+
+// Read by the IRQ stubs in boot.asm: non-zero = fxsave/fxrstor
+// the FPU/SSE state around every interrupt handler.
+u8 cpu_fxsave_enabled = 0;
+
+bool cpu_enable_sse(void) {
+    if (!cpu_has(CPUID_EDX_FXSR) || !cpu_has(CPUID_EDX_SSE)) return false;
+
+    write_cr0((read_cr0() & ~CR0_EM) | CR0_MP);
+    u32 cr4;
+    __asm__ volatile ("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    __asm__ volatile ("mov %0, %%cr4" : : "r"(cr4) : "memory");
+    __asm__ volatile ("fninit");
+
+    cpu_fxsave_enabled = 1;
+    return true;
+}
+
+bool cpu_sse_enabled(void) {
+    return cpu_fxsave_enabled != 0;
+}
+
+// ============================================================
+// MTRR
+// ============================================================
+
+// Flush the whole TLB: reloading CR3 drops non-global entries,
+// toggling CR4.PGE drops global ones too
+static void tlb_flush(void) {
+    u32 cr3, cr4;
+    __asm__ volatile ("mov %%cr3, %0; mov %0, %%cr3" : "=r"(cr3) : : "memory");
+    __asm__ volatile ("mov %%cr4, %0" : "=r"(cr4));
+    if (cr4 & CR4_PGE) {
+        __asm__ volatile ("mov %0, %%cr4" : : "r"(cr4 & ~CR4_PGE) : "memory");
+        __asm__ volatile ("mov %0, %%cr4" : : "r"(cr4) : "memory");
+    }
+}
+
+// Follows the SDM update sequence: caches off, caches and TLB flushed
+// while the MTRRs are disabled, so no stale line or translation
+// survives with the old type.
+static void mtrr_begin(u32 *saved_cr0, u32 *saved_flags) {
+    __asm__ volatile ("pushf; pop %0; cli" : "=r"(*saved_flags));
+    *saved_cr0 = read_cr0();
+    write_cr0((*saved_cr0 | CR0_CD) & ~CR0_NW);
+    __asm__ volatile ("wbinvd" ::: "memory");
+    tlb_flush();
+    cpu_wrmsr(MSR_MTRR_DEF_TYPE, cpu_rdmsr(MSR_MTRR_DEF_TYPE) & ~(u64)MTRR_DEF_ENABLE);
+}
+
+static void mtrr_end(u32 saved_cr0, u32 saved_flags) {
+    __asm__ volatile ("wbinvd" ::: "memory");
+    tlb_flush();
+    cpu_wrmsr(MSR_MTRR_DEF_TYPE, cpu_rdmsr(MSR_MTRR_DEF_TYPE) | MTRR_DEF_ENABLE);
+    write_cr0(saved_cr0);
+    __asm__ volatile ("push %0; popf" : : "r"(saved_flags) : "memory", "cc");
+}
+
+// Largest naturally aligned power-of-two block at base that fits in size
+static u32 mtrr_block(u32 base, u32 size) {
+    u32 block = base ? (base & (~base + 1)) : 0x80000000u;
+    while (block > size) block >>= 1;
+    return block;
+}
+
+// Mark [base, base+size) write-combining with variable-range MTRRs.
+// Returns the number of MTRRs used, 0 if unsupported or out of free
+// ranges, -1 if an existing UC range overlaps (UC would win over WC).
+int mtrr_set_wc(u32 base, u32 size) {
+    if (!cpu_has(CPUID_EDX_MTRR) || size == 0) return 0;
+
+    u64 cap = cpu_rdmsr(MSR_MTRRCAP);
+    u32 vcnt = (u32)cap & 0xFF;
+    if (!(cap & (1u << 10))) return 0;          // no WC type
+
+    u64 phys_mask = (((u64)1) << cpu_phys_bits()) - 1;
+    base &= ~0xFFFu;
+    size = (size + 0xFFF) & ~0xFFFu;
+
+    // A UC variable range overlapping ours would win over WC.
+    // Ranges are taken as contiguous [start, start + ~mask + 1).
+    u64 end = (u64)base + size;
+    for (u32 i = 0; i < vcnt; i++) {
+        u64 mask = cpu_rdmsr(MSR_MTRR_PHYSMASK0 + 2 * i);
+        if (!(mask & MTRR_VALID)) continue;
+        u64 pbase = cpu_rdmsr(MSR_MTRR_PHYSBASE0 + 2 * i);
+        if ((pbase & 0xFF) != MTRR_TYPE_UC) continue;
+        u64 m = mask & phys_mask & ~0xFFFull;
+        u64 pstart = pbase & m;
+        u64 pend = pstart + (~m & phys_mask) + 1;
+        if (pstart < end && (u64)base < pend) return -1;
+    }
+
+    // Make sure every block gets a range before touching anything
+    u32 free_slots = 0, needed = 0;
+    for (u32 i = 0; i < vcnt; i++)
+        if (!(cpu_rdmsr(MSR_MTRR_PHYSMASK0 + 2 * i) & MTRR_VALID)) free_slots++;
+    for (u32 b = base, left = size; left; needed++) {
+        u32 block = mtrr_block(b, left);
+        b += block;
+        left -= block;
+    }
+    if (needed > free_slots) return 0;
+
+    u32 saved_cr0, saved_flags;
+    u32 slot = 0;
+    mtrr_begin(&saved_cr0, &saved_flags);
+    while (size) {
+        u32 block = mtrr_block(base, size);
+        while (cpu_rdmsr(MSR_MTRR_PHYSMASK0 + 2 * slot) & MTRR_VALID) slot++;
+        cpu_wrmsr(MSR_MTRR_PHYSBASE0 + 2 * slot, (u64)base | MTRR_TYPE_WC);
+        cpu_wrmsr(MSR_MTRR_PHYSMASK0 + 2 * slot,
+                  ((~(u64)(block - 1)) & phys_mask & ~0xFFFull) | MTRR_VALID);
+        base += block;
+        size -= block;
+    }
+    mtrr_end(saved_cr0, saved_flags);
+    return (int)needed;
+}
+
+// ============================================================
+// PAT
+// ============================================================
+
+// Reprogram PAT entry 1 (PWT=1, PCD=0) from WT to WC, so any page
+// mapped with only PWT set becomes write-combining.
+bool pat_init(void) {
+    if (!cpu_has(CPUID_EDX_PAT)) return false;
+    u64 pat = cpu_rdmsr(MSR_PAT);
+    pat &= ~((u64)0xFF << 8);
+    pat |=  ((u64)MTRR_TYPE_WC << 8);
+    cpu_wrmsr(MSR_PAT, pat);
+    return true;
+}
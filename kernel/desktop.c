@@ -27,6 +27,10 @@ static desktop_icon_t icons[] = {
 
 static int selected_icon = -1;
 
+// Only one app runs at a time; whatever it allocates here goes
+// back in one step when its run() returns
+arena_t app_arena;
+
 // ============================================================
 // DRAW BACKGROUND (arctic gradient)
 // ============================================================
@@ -40,12 +44,12 @@ static void draw_background(void) {
         u8 g = 0x08 + (ratio * 0x18 / 255);
         u8 b = 0x18 + (ratio * 0x38 / 255);
         u32 color = (r << 16) | (g << 8) | b;
-        for (u32 x = 0; x < w; x++)
-            fb_put_pixel(x, y, color);
+        fb_fill_rect(0, y, w, 1, color);
     }
 
     // Snowflakes / aurora effect
     // Random brightness points (seeded)
+    fb_pixels_begin();
     for (int i = 0; i < 200; i++) {
         int sx = (i * 1337 + i * i * 47) % w;
         int sy = (i * 2341 + i * 113) % (int)h;
@@ -69,11 +73,50 @@ static void draw_background(void) {
             fb_put_pixel(x, aurora_y + t, ac);
         }
     }
+    fb_pixels_end();
 }
 
 // ============================================================
 // DRAW TASKBAR
 // ============================================================
+static char tb_time[16] = "";   // strings currently on the taskbar
+static char tb_date[32] = "";
+
+static void taskbar_clock_strings(char *time_str, char *date_str) {
+    rtc_time_t t;
+    rtc_get_time(&t);
+    t.hour = (t.hour + 1) % 24; // UTC+1 (CET)
+    ksprintf(time_str, "%02d:%02d:%02d", (u32)t.hour, (u32)t.minute, (u32)t.second);
+    ksprintf(date_str, "%s %02d.%02d.%u",
+        rtc_weekday_str(t.weekday), (u32)t.day, (u32)t.month, (u32)t.year);
+}
+
+// Redraw only the character cells that differ from what is shown
+static void taskbar_update_text(char *shown, const char *now, int x, int y, u32 fg) {
+    int i = 0;
+    for (; now[i]; i++) {
+        if (shown[i] != now[i]) {
+            fb_draw_char(x + i * 8, y, now[i], fg, COLOR_ARCTIC_WIN, 1);
+            if (!shown[i]) shown[i + 1] = '\0';   // string grew
+            shown[i] = now[i];
+        }
+    }
+    if (shown[i]) {
+        // New string is shorter - blank the leftover cells
+        fb_fill_rect(x + i * 8, y, kstrlen(shown + i) * 8, 8, COLOR_ARCTIC_WIN);
+        shown[i] = '\0';
+    }
+}
+
+static void taskbar_update_clock(void) {
+    int bar_y  = fb.height - TASKBAR_H;
+    int time_x = fb.width - 130;
+    char time_str[16], date_str[32];
+    taskbar_clock_strings(time_str, date_str);
+    taskbar_update_text(tb_time, time_str, time_x, bar_y + 6,  COLOR_ARCTIC_ACC);
+    taskbar_update_text(tb_date, date_str, time_x, bar_y + 22, COLOR_LIGHT_GRAY);
+}
+
 static void draw_taskbar(void) {
     int bar_y = fb.height - TASKBAR_H;
 
@@ -87,20 +130,12 @@ static void draw_taskbar(void) {
     fb_draw_string(13, bar_y + 12, "ArcticOS", COLOR_ARCTIC_ACC, COLOR_ARCTIC_BTN, 1);
 
     // Clock on taskbar (RTC)
-    rtc_time_t t;
-    rtc_read(&t);
-    t.hour = (t.hour + 1) % 24; // UTC+1 (CET)
-    char time_str[32];
-    ksprintf(time_str, "%02d:%02d:%02d", (u32)t.hour, (u32)t.minute, (u32)t.second);
-    char date_str[32];
-    ksprintf(date_str, "%s %02d.%02d.%u",
-        rtc_weekday_str(t.weekday), (u32)t.day, (u32)t.month, (u32)t.year);
-
     int time_x = fb.width - 130;
     fb_fill_rect(time_x - 5, bar_y + 3, 125, 34, COLOR_ARCTIC_WIN);
     fb_draw_rect(time_x - 5, bar_y + 3, 125, 34, 0x002255AA, 1);
-    fb_draw_string(time_x, bar_y + 6,  time_str, COLOR_ARCTIC_ACC, COLOR_ARCTIC_WIN, 1);
-    fb_draw_string(time_x, bar_y + 22, date_str, COLOR_LIGHT_GRAY, COLOR_ARCTIC_WIN, 1);
+    taskbar_clock_strings(tb_time, tb_date);
+    fb_draw_string(time_x, bar_y + 6,  tb_time, COLOR_ARCTIC_ACC, COLOR_ARCTIC_WIN, 1);
+    fb_draw_string(time_x, bar_y + 22, tb_date, COLOR_LIGHT_GRAY, COLOR_ARCTIC_WIN, 1);
 
     // Active app description
     fb_draw_string(100, bar_y + 13, "Click an app icon above [1][2][3]",
@@ -110,77 +145,133 @@ static void draw_taskbar(void) {
 // ============================================================
 // DRAW APPLICATION ICONS
 // ============================================================
-static void draw_icons(void) {
-    int start_x = 30;
-    int start_y = 30;
+static void draw_icon(int i, bool sel) {
+    int ix = 30 + i * (ICON_SIZE + ICON_PADDING);
+    int iy = 30;
+    icons[i].x = ix;
+    icons[i].y = iy;
 
-    for (int i = 0; i < ICON_COUNT; i++) {
-        int ix = start_x + i * (ICON_SIZE + ICON_PADDING);
-        int iy = start_y;
-        icons[i].x = ix;
-        icons[i].y = iy;
+    u32 bg = icons[i].color;
 
-        u32 bg = icons[i].color;
-        bool sel = (selected_icon == i);
+    // Shadow
+    fb_fill_rect(ix+4, iy+4, ICON_SIZE, ICON_SIZE, 0x00080808);
 
-        // Shadow
-        fb_fill_rect(ix+4, iy+4, ICON_SIZE, ICON_SIZE, 0x00080808);
+    // Icon background
+    fb_fill_rect(ix, iy, ICON_SIZE, ICON_SIZE, bg);
 
-        // Icon background
-        fb_fill_rect(ix, iy, ICON_SIZE, ICON_SIZE, bg);
+    // Border
+    fb_draw_rect(ix, iy, ICON_SIZE, ICON_SIZE,
+        sel ? COLOR_ARCTIC_ACC : 0x00336699, sel ? 2 : 1);
 
-        // Border
-        fb_draw_rect(ix, iy, ICON_SIZE, ICON_SIZE,
-            sel ? COLOR_ARCTIC_ACC : 0x00336699, sel ? 2 : 1);
+    // Center label (large)
+    fb_draw_string(ix + 8, iy + 18, icons[i].icon_label,
+        COLOR_WHITE, bg, 2);
 
-        // Center label (large)
-        fb_draw_string(ix + 8, iy + 18, icons[i].icon_label,
-            COLOR_WHITE, bg, 2);
+    // Shortcut number
+    char num[3] = {'[', '1'+i, ']'};
+    num[2] = 0;
+    fb_draw_string(ix + 2, iy + 2, num, COLOR_ARCTIC_ACC, bg, 1);
 
-        // Shortcut number
-        char num[3] = {'[', '1'+i, ']'};
-        num[2] = 0;
-        fb_draw_string(ix + 2, iy + 2, num, COLOR_ARCTIC_ACC, bg, 1);
+    // Name below icon
+    int name_len = kstrlen(icons[i].name) * 8;
+    int name_x = ix + (ICON_SIZE - name_len) / 2;
+    fb_fill_rect(ix - 2, iy + ICON_SIZE + 2, ICON_SIZE + 4, 16, COLOR_ARCTIC_BG);
+    fb_draw_string(name_x, iy + ICON_SIZE + 3, icons[i].name,
+        COLOR_TEXT_BRIGHT, COLOR_ARCTIC_BG, 1);
+}
+
+// ============================================================
+// CACHED DESKTOP LAYER
+// Background + unselected icons are rendered once into a 32 bpp
+// surface; redraws just blit it into the back buffer.
+// ============================================================
+static u32  desktop_cache[FB_MAX_WIDTH * FB_MAX_HEIGHT] __attribute__((aligned(16)));
+static fb_surface_t desktop_layer;
+static bool desktop_cache_valid = false;
+static u32  desktop_cache_mode;     // fb.mode_id the layer was drawn in
 
-        // Name below icon
-        int name_len = kstrlen(icons[i].name) * 8;
-        int name_x = ix + (ICON_SIZE - name_len) / 2;
-        fb_fill_rect(ix - 2, iy + ICON_SIZE + 2, ICON_SIZE + 4, 16, COLOR_ARCTIC_BG);
-        fb_draw_string(name_x, iy + ICON_SIZE + 3, icons[i].name,
-            COLOR_TEXT_BRIGHT, COLOR_ARCTIC_BG, 1);
+static void draw_static_layer(void) {
+    int w = fb.width, h = fb.height - TASKBAR_H;
+    if (w > FB_MAX_WIDTH || h > FB_MAX_HEIGHT) {
+        // Too big to cache: draw it every time
+        draw_background();
+        for (int i = 0; i < ICON_COUNT; i++)
+            draw_icon(i, false);
+        return;
+    }
+    if (!desktop_cache_valid || desktop_cache_mode != fb.mode_id) {
+        fb_surface_init(&desktop_layer, w, h, FB_FORMAT_XRGB8888, desktop_cache);
+        fb_surface_t *screen = fb_set_target(&desktop_layer);
+        draw_background();
+        for (int i = 0; i < ICON_COUNT; i++)
+            draw_icon(i, false);
+        fb_set_target(screen);
+        desktop_cache_valid = true;
+        desktop_cache_mode  = fb.mode_id;
     }
+    fb_blit(NULL, 0, 0, &desktop_layer);
+}
+
+// Everything under the windows; the window manager calls this with
+// drawing clipped to the area it needs
+static void desktop_paint(void) {
+    draw_static_layer();
+    if (selected_icon >= 0)
+        draw_icon(selected_icon, true);
+    draw_taskbar();
+}
+
+static void desktop_repaint_icon(int i) {
+    fb_rect_t r = { icons[i].x, icons[i].y, ICON_SIZE, ICON_SIZE };
+    wm_repaint(&r);
 }
 
 // ============================================================
 // DRAW FULL DESKTOP
 // ============================================================
 void desktop_draw(void) {
-    draw_background();
-    draw_icons();
-    draw_taskbar();
+    wm_repaint(NULL);
 }
 
 // ============================================================
 // INITIALIZATION
 // ============================================================
 void desktop_init(void) {
-    fb_clear(COLOR_ARCTIC_BG);
+    desktop_cache_valid = false;
+    wm_set_background(desktop_paint);
     desktop_draw();
 }
 
 // ============================================================
 // MAIN DESKTOP LOOP
 // ============================================================
+// Taskbar clock on the timer queue. The RTC update interrupt marks
+// each new second; the timer comes back a second after it saw one,
+// and polls briefly if that was early, so it stays in step with the
+// RTC on one or two wakeups a second.
+#define TASKBAR_POLL_NS  20000000ull
+
+static u32 desktop_rtc_seen;
+
+static void taskbar_timer(void *arg) {
+    (void)arg;
+    u64 now = ktime_ns();
+    if (rtc_get_updates() == desktop_rtc_seen) {
+        ktimer_add(now + TASKBAR_POLL_NS, taskbar_timer, NULL);
+        return;
+    }
+    desktop_rtc_seen = rtc_get_updates();
+    taskbar_update_clock();     // touches only the changed digits
+    fb_present();
+    ktimer_add(now + 1000000000ull, taskbar_timer, NULL);
+}
+
 void desktop_run(void) {
-    u32 last_ticks = 0;
+    desktop_rtc_seen = rtc_get_updates();
+    ktimer_add(ktime_ns() + TASKBAR_POLL_NS, taskbar_timer, NULL);
 
     while (1) {
-        // Refresh every ~1s (100 ticks at 100Hz)
-        u32 t = timer_get_ticks();
-        if (t - last_ticks >= 100) {
-            last_ticks = t;
-            draw_taskbar(); // Refresh clock
-        }
+        frame_wait(true);
 
         // Keyboard input
         if (keyboard_has_char()) {
@@ -192,18 +283,21 @@ void desktop_run(void) {
 
             if (app >= 0 && app < ICON_COUNT) {
                 selected_icon = app;
-                desktop_draw();
+                desktop_repaint_icon(app);
+                fb_present();
                 // Short visual pause
-                u32 wait = timer_get_ticks() + 20;
-                while (timer_get_ticks() < wait) __asm__("hlt");
-                // Launch app
+                timer_sleep(200);
+                // Launch app (the taskbar keeps ticking whenever the
+                // app waits on the frame scheduler or sleeps)
+                TRACE(TRACE_APP_START, app, 0);
                 icons[app].run();
-                // After return: refresh desktop
+                TRACE(TRACE_APP_EXIT, app, 0);
+                arena_release(&app_arena);
+                // The app closed its window, which repainted what it
+                // covered; only the highlight is left to clear
                 selected_icon = -1;
-                desktop_draw();
+                desktop_repaint_icon(app);
             }
         }
-
-        __asm__ volatile("hlt");
     }
 }
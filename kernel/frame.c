@@ -0,0 +1,112 @@
+#include "../include/kernel.h"
+
+// ============================================================
+// FRAME SCHEDULER
+// Clients register an update and a draw callback. Every frame
+// (FRAME_DEFAULT_HZ off ktime_ns) each update is told the time and
+// says whether its client needs drawing; dirty clients draw, and
+// the frame is presented only if that left damage. The time spent
+// is measured with ktime_ns() against a budget of one frame period.
+// frame_scratch is emptied before each frame, so callbacks can use
+// it for strings and layout that only live until they return.
+// With no clients at all no frames are due, and frame_wait() sleeps
+// until a key (or a queued timer) instead of waking every period.
+// ============================================================
+#define FRAME_MAX_CLIENTS  8
+#define FRAME_DEFAULT_HZ   60
+
+typedef struct {
+    bool (*update)(u32 now_ms);
+    void (*draw)(void);
+    bool used;
+} frame_client_t;
+
+static frame_client_t frame_clients[FRAME_MAX_CLIENTS];
+static u32 frame_hz = FRAME_DEFAULT_HZ;
+static u64 frame_next_ns;       // when the next frame is due
+static u32 frame_period_ns;
+static frame_stats_t stats;
+
+arena_t frame_scratch;
+
+void frame_init(void) {
+    frame_set_rate(FRAME_DEFAULT_HZ);
+}
+
+void frame_set_rate(u32 hz) {
+    if (hz == 0 || hz > 1000) hz = FRAME_DEFAULT_HZ;
+    frame_hz = hz;
+    frame_period_ns = 1000000000 / hz;
+    frame_next_ns = ktime_ns();
+    stats.budget_us = 1000000 / hz;
+}
+
+static bool frame_any_client(void) {
+    for (int i = 0; i < FRAME_MAX_CLIENTS; i++)
+        if (frame_clients[i].used) return true;
+    return false;
+}
+
+int frame_add(bool (*update)(u32 now_ms), void (*draw)(void)) {
+    // Frames start again from now, not from when the last client left
+    if (!frame_any_client()) frame_next_ns = ktime_ns();
+    for (int i = 0; i < FRAME_MAX_CLIENTS; i++) {
+        if (frame_clients[i].used) continue;
+        frame_clients[i].update = update;
+        frame_clients[i].draw   = draw;
+        frame_clients[i].used   = true;
+        return i;
+    }
+    return -1;
+}
+
+void frame_remove(int id) {
+    if (id >= 0 && id < FRAME_MAX_CLIENTS)
+        frame_clients[id].used = false;
+}
+
+static void frame_run(u32 now) {
+    u64 t0 = ktime_ns();
+    bool dirty[FRAME_MAX_CLIENTS];
+    arena_reset(&frame_scratch);
+
+    for (int i = 0; i < FRAME_MAX_CLIENTS; i++) {
+        frame_client_t *c = &frame_clients[i];
+        dirty[i] = c->used && (!c->update || c->update(now));
+    }
+    for (int i = 0; i < FRAME_MAX_CLIENTS; i++)
+        if (dirty[i] && frame_clients[i].used && frame_clients[i].draw)
+            frame_clients[i].draw();
+
+    stats.frames++;
+    if (fb_has_damage()) fb_present();
+    else                 stats.idle++;
+
+    u32 us = (u32)kdiv64(ktime_ns() - t0, 1000, NULL);
+    stats.last_us = us;
+    if (us > stats.max_us) stats.max_us = us;
+    if (us > stats.budget_us) stats.over_budget++;
+}
+
+// Sleep until the next frame is due and run it. With wake_on_key
+// it returns early, without running it, once a key is waiting.
+void frame_wait(bool wake_on_key) {
+    bool any = frame_any_client();
+    if (!any && !wake_on_key) return;   // nothing would ever wake us
+    if (!ktimer_wait(any ? frame_next_ns : KTIME_NEVER, wake_on_key)) return;
+
+    frame_next_ns += frame_period_ns;
+
+    // Fell more than a frame behind: drop the missed ones
+    u64 now = ktime_ns();
+    if (now >= frame_next_ns) {
+        stats.dropped += (u32)kdiv64(now - frame_next_ns, frame_period_ns, NULL) + 1;
+        frame_next_ns = now + frame_period_ns;
+    }
+    frame_run((u32)kdiv64(now, 1000000, NULL));
+}
+
+void frame_get_stats(frame_stats_t *out) {
+    *out = stats;
+    out->hz = frame_hz;
+}
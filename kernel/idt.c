@@ -81,8 +81,8 @@ void pic_init(void) {
     // ICW4
     outb(PIC1_DATA, 0x01);
     outb(PIC2_DATA, 0x01);
-    // Mask: enable IRQ0, IRQ1, IRQ8
-    outb(PIC1_DATA, 0b11111100);
+    // Mask: enable IRQ0, IRQ1, IRQ2 (cascade, needed for IRQ8), IRQ8
+    outb(PIC1_DATA, 0b11111000);
     outb(PIC2_DATA, 0b11111110);
 }
 
@@ -104,17 +104,39 @@ void isr_handler(int num) {
     if (num < 15) {
         fb_draw_string(10, 90, exception_names[num], COLOR_WHITE, 0x000000CC, 2);
     }
+    if (num == 14) {
+        u32 cr2;
+        __asm__ volatile ("mov %%cr2, %0" : "=r"(cr2));
+        ksprintf(buf, "Address: 0x%x", cr2);
+        fb_draw_string(10, 120, buf, COLOR_YELLOW, 0x000000CC, 1);
+    }
+    fb_draw_string(10, 140, "System halted. Restart required.", COLOR_LIGHT_GRAY, 0x000000CC, 1);
+    fb_present();
+    disable_interrupts();
+    for (;;) { __asm__ volatile("hlt"); }
+}
+
+// Fatal condition outside an exception: same screen, then stop
+void kernel_panic(const char *msg) {
+    fb_fill_rect(0, 0, fb.width, fb.height, 0x000000CC);
+    fb_draw_string(10, 10, "=== ArcticOS KERNEL PANIC ===", COLOR_WHITE, 0x000000CC, 2);
+    fb_draw_string(10, 50, msg, COLOR_YELLOW, 0x000000CC, 1);
     fb_draw_string(10, 140, "System halted. Restart required.", COLOR_LIGHT_GRAY, 0x000000CC, 1);
+    fb_present();
     disable_interrupts();
     for (;;) { __asm__ volatile("hlt"); }
 }
 
-void irq_handler(int irq_num) {
+void irq_handler(int irq_num, const irq_frame_t *frame) {
+    TRACE(TRACE_IRQ_ENTER, irq_num, 0);
     switch (irq_num) {
-        case 0: timer_sleep(0); break;  // Timer tick (handled internally)
+        case 0: timer_irq(); break;
         case 1: keyboard_handler(); break;
-        case 8: rtc_handler(); break;
+        case 8:
+            if (rtc_handler() & RTC_IRQ_PERIODIC) prof_sample(frame);
+            break;
     }
+    TRACE(TRACE_IRQ_EXIT, irq_num, 0);
     // EOI
     if (irq_num >= 8)
         outb(PIC2_CMD, 0x20);
@@ -2,18 +2,83 @@
 
 framebuffer_t fb;
 
-// Prosta funkcja opóźniająca dla efektu wizualnego
-static void boot_delay(u32 count) {
-    for (volatile u32 i = 0; i < count * 10000; i++) {
-        __asm__ volatile("nop");
+// Splash: pasek ładowania jako klient schedulera klatek
+#define SPLASH_MS 1500
+
+static int splash_x, splash_y, splash_w;
+static u32 splash_start;
+static int splash_progress = -1;   // ostatnio narysowany postęp
+static int splash_target;
+
+static const char* stages[] = {
+    "Loading GDT...",
+    "Setting up IDT...",
+    "Initializing PIC...",
+    "Detecting Hardware...",
+    "Starting ArcticOS..."
+};
+
+static bool splash_update(u32 now_ms) {
+    int p = (int)((now_ms - splash_start) * 100 / SPLASH_MS);
+    splash_target = p > 100 ? 100 : p;
+    return splash_target != splash_progress;
+}
+
+static void splash_draw(void) {
+    int from = splash_progress + 1;
+    int p = splash_target;
+    splash_progress = p;
+    fb_draw_loading_bar(splash_x, splash_y, splash_w, 8, p, 0x0000DFFF);
+
+    // Zmiana tekstu co 25% postępu
+    for (int i = from; i <= p; i++) {
+        if (i % 25 == 0 && (i/25) < 5) {
+            fb_fill_rect(splash_x, splash_y + 15, splash_w, 10, 0x00050A0F);
+            fb_draw_string(splash_x, splash_y + 15, stages[i/25], 0x00AAAAAA, COLOR_TRANSPARENT, 1);
+        }
     }
 }
 
+// Czy linia poleceń z bootloadera (Multiboot 1 lub 2) zawiera słowo
+static bool boot_has_arg(u32 magic, multiboot_info_t *mbi, const char *word) {
+    const char *cmd = NULL;
+    if (magic == MBOOT2_MAGIC) {
+        mb2_info_t *mb2 = (mb2_info_t *)mbi;
+        u8 *p   = (u8 *)mb2 + 8;
+        u8 *end = (u8 *)mb2 + mb2->total_size;
+        while (p < end && !cmd) {
+            mb2_tag_t *tag = (mb2_tag_t *)p;
+            if (tag->type == 0) break;
+            if (tag->type == MB2_TAG_CMDLINE) cmd = (const char *)(tag + 1);
+            p += (tag->size + 7) & ~7u;
+        }
+    } else if (mbi->flags & MB1_FLAG_CMDLINE) {
+        cmd = (const char *)mbi->cmdline;
+    }
+    if (!cmd) return false;
+    int n = kstrlen(word);
+    for (const char *s = cmd; *s; s++)
+        if ((s == cmd || s[-1] == ' ') && kstrncmp(s, word, n) == 0 &&
+            (s[n] == ' ' || s[n] == '\0'))
+            return true;
+    return false;
+}
+
+static void serial_line(const char *line) {
+    serial_write(line);
+    serial_write("\n");
+}
+
 void kernel_main(u32 magic, multiboot_info_t *mbi) {
+    // Linia poleceń przed pmm_init, który może nadpisać jej pamięć
+    bool bench_mode = boot_has_arg(magic, mbi, "bench");
+
     // 1. Inicjalizacja sprzętowa (GDT, IDT itp.)
     gdt_init();
     idt_init();
     pic_init();
+    cpu_enable_sse();
+    blit_init();
 
     // 2. Detekcja Framebuffera
     if (magic == MBOOT2_MAGIC) {
@@ -21,6 +86,32 @@ void kernel_main(u32 magic, multiboot_info_t *mbi) {
     } else {
         fb_init(mbi);
     }
+    bga_init();     // -vga std: two pages, tear-free presents
+
+    // Pamięć fizyczna z mapy Multiboot (po framebufferze, który rezerwuje)
+    pmm_init(magic, mbi);
+    slab_init();
+
+    // Stronicowanie: RAM 1:1 w stronach 4 MiB, potem VRAM jako WC
+    paging_init();
+    fb_enable_write_combining();
+
+    // Sterowniki: timer jest potrzebny do animacji
+    timer_init(TIMER_HZ);
+    keyboard_init();
+    serial_init();          // COM1: zrzuty profilera
+    rtc_init();
+    enable_interrupts();
+    clocksource_init();     // kalibracja TSC względem PIT (~100 ms), potem PIT bez ticków
+    frame_init();
+
+    // make bench: wyniki na COM1, potem wyjście przez isa-debug-exit
+    // (bez tego urządzenia zapis jest ignorowany i system startuje dalej)
+    if (bench_mode) {
+        bench_run(NULL, serial_line);
+        serial_write("bench done\n");
+        outb(QEMU_EXIT_PORT, 0);
+    }
 
     // 3. Sekwencja Splash Screen (ArcticOS Boot)
     fb_clear(0x00050A0F); // Ciemny arktyczny granat
@@ -30,42 +121,21 @@ void kernel_main(u32 magic, multiboot_info_t *mbi) {
     
     // Rysuj logo w kolorze lodowym błękicie
     fb_draw_logo(lx, ly, 0x00A0EFFF); 
-    fb_draw_string(lx + 10, ly + LOGO_HEIGHT + 10, "ArcticOS Kernel", 0x00FFFFFF, 0x00000000, 1);
+    fb_draw_string(lx + 10, ly + LOGO_HEIGHT + 10, "ArcticOS Kernel", 0x00FFFFFF, COLOR_TRANSPARENT, 1);
 
     // 4. Animacja paska ładowania z komunikatami
-    int barW = 200;
-    int barX = (fb.width - barW) / 2;
-    int barY = ly + LOGO_HEIGHT + 40;
-
-    const char* stages[] = {
-        "Loading GDT...",
-        "Setting up IDT...",
-        "Initializing PIC...",
-        "Detecting Hardware...",
-        "Starting ArcticOS..."
-    };
-
-    for (int i = 0; i <= 100; i++) {
-        fb_draw_loading_bar(barX, barY, barW, 8, i, 0x0000DFFF);
-        
-        // Zmiana tekstu co 25% postępu
-        if (i % 25 == 0 && (i/25) < 5) {
-            // Czyścimy poprzedni tekst małym prostokątem (opcjonalnie)
-            fb_fill_rect(barX, barY + 15, barW, 10, 0x00050A0F);
-            fb_draw_string(barX, barY + 15, stages[i/25], 0x00AAAAAA, 0x00000000, 1);
-        }
-        
-        boot_delay(150); // Kontrola prędkości animacji
-    }
+    splash_w = 200;
+    splash_x = (fb.width - splash_w) / 2;
+    splash_y = ly + LOGO_HEIGHT + 40;
+    splash_start = timer_get_ms();
 
-    // 5. Inicjalizacja sterowników po animacji
-    timer_init(100);
-    keyboard_init();
-    rtc_init();
-    enable_interrupts();
+    int splash = frame_add(splash_update, splash_draw);
+    while (splash_progress < 100)
+        frame_wait(false);
+    frame_remove(splash);
 
-    // 6. Uruchomienie pulpitu (Desktop)
-    boot_delay(500); // Chwila pauzy na 100%
+    // 5. Uruchomienie pulpitu (Desktop)
+    timer_sleep(300); // Chwila pauzy na 100%
     desktop_init();
     desktop_run();
 
@@ -0,0 +1,133 @@
+#include "../include/kernel.h"
+
+// ============================================================
+// TIMER QUEUE
+// Pending deadlines (in ktime_ns) sit in a binary min-heap. Nothing
+// here runs in interrupt context: ktimer_wait() calls whatever is
+// due, arms the PIT one-shot for the earliest deadline left and
+// halts, so the CPU sleeps until a timer is due, a key arrives or
+// the RTC ticks. Ids carry a generation count, so cancelling a
+// timer that has already fired never hits the slot's next user.
+// ============================================================
+#define KTIMER_MAX  16
+
+typedef struct {
+    u64 at;
+    void (*fn)(void *arg);
+    void *arg;
+    u32 gen;
+    int pos;                        // index in heap
+    bool used;
+} ktimer_t;
+
+static ktimer_t ktimers[KTIMER_MAX];
+static u8  heap[KTIMER_MAX];        // slots, earliest deadline first
+static int heap_n;
+
+static bool heap_before(int a, int b) {
+    return ktimers[heap[a]].at < ktimers[heap[b]].at;
+}
+
+static void heap_swap(int a, int b) {
+    u8 t = heap[a];
+    heap[a] = heap[b];
+    heap[b] = t;
+    ktimers[heap[a]].pos = a;
+    ktimers[heap[b]].pos = b;
+}
+
+static void heap_up(int i) {
+    while (i > 0 && heap_before(i, (i - 1) / 2)) {
+        heap_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void heap_down(int i) {
+    for (;;) {
+        int m = i, l = 2 * i + 1, r = l + 1;
+        if (l < heap_n && heap_before(l, m)) m = l;
+        if (r < heap_n && heap_before(r, m)) m = r;
+        if (m == i) return;
+        heap_swap(i, m);
+        i = m;
+    }
+}
+
+// Take heap[i] out and free its slot
+static void heap_remove(int i) {
+    ktimer_t *t = &ktimers[heap[i]];
+    heap_n--;
+    if (i != heap_n) {
+        u8 last = heap[heap_n];
+        heap[i] = last;
+        ktimers[last].pos = i;
+        heap_up(i);
+        heap_down(ktimers[last].pos);
+    }
+    t->used = false;
+    t->gen++;
+}
+
+// Call fn(arg) once ktime_ns() reaches `at`; -1 if the queue is full
+int ktimer_add(u64 at, void (*fn)(void *arg), void *arg) {
+    for (int s = 0; s < KTIMER_MAX; s++) {
+        ktimer_t *t = &ktimers[s];
+        if (t->used) continue;
+        t->at   = at;
+        t->fn   = fn;
+        t->arg  = arg;
+        t->used = true;
+        t->pos  = heap_n;
+        heap[heap_n++] = (u8)s;
+        heap_up(t->pos);
+        return (int)((t->gen & 0xFFFFFF) * KTIMER_MAX + s);
+    }
+    return -1;
+}
+
+void ktimer_cancel(int id) {
+    if (id < 0) return;
+    ktimer_t *t = &ktimers[id % KTIMER_MAX];
+    if (t->used && (t->gen & 0xFFFFFF) == (u32)id / KTIMER_MAX)
+        heap_remove(t->pos);
+}
+
+// Earliest pending deadline, KTIME_NEVER if none
+static u64 ktimer_next(void) {
+    return heap_n ? ktimers[heap[0]].at : KTIME_NEVER;
+}
+
+static void ktimer_run(void) {
+    u64 now = ktime_ns();
+    while (heap_n && ktimers[heap[0]].at <= now) {
+        ktimer_t *t = &ktimers[heap[0]];
+        void (*fn)(void *) = t->fn;
+        void *arg = t->arg;
+        heap_remove(0);             // fn may re-add itself
+        fn(arg);
+    }
+}
+
+// Sleep until ktime_ns() reaches `until` (KTIME_NEVER: no limit),
+// running due timers meanwhile. True once `until` has passed; with
+// wake_on_key, false as soon as a key is waiting.
+bool ktimer_wait(u64 until, bool wake_on_key) {
+    for (;;) {
+        ktimer_run();
+        u64 now = ktime_ns();
+        if (now >= until) return true;
+        u64 next = ktimer_next();
+        if (until < next) next = until;
+
+        // Test and halt with interrupts off: sti only takes effect
+        // after the hlt, so a key arriving in between still wakes it
+        disable_interrupts();
+        if (wake_on_key && keyboard_has_char()) {
+            enable_interrupts();
+            return false;
+        }
+        if (next != KTIME_NEVER) timer_arm(next - now);
+        __asm__ volatile("sti; hlt");
+    }
+}
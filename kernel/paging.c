@@ -0,0 +1,156 @@
+#include "../include/kernel.h"
+
+// ============================================================
+// PAGING
+// Physical memory stays identity mapped, so turning paging on
+// changes no address the kernel uses. RAM is covered with 4 MiB
+// PSE pages wherever a whole aligned 4 MiB fits; a page table of
+// 4 KiB pages only appears where finer control is needed: the
+// unmapped NULL page, the edges of an MMIO range, or a range
+// remapped with another cache type. Cache types come from the PAT
+// index bits (PWT/PCD) of each entry.
+// ============================================================
+#define PG_PRESENT   0x001
+#define PG_WRITE     0x002
+#define PG_PWT       0x008
+#define PG_PCD       0x010
+#define PG_LARGE     0x080          // PDE: 4 MiB page
+#define PG_CACHE     (PG_PWT | PG_PCD)
+#define LARGE_SIZE   0x400000u
+
+#define CR0_PG       (1u << 31)
+#define CR4_PSE      (1u << 4)
+
+static u32  page_dir[1024] __attribute__((aligned(4096)));
+static bool paging_pse = false;
+
+static void paging_flush(void) {
+    if (!cpu_paging_enabled()) return;
+    u32 cr3;
+    __asm__ volatile ("mov %%cr3, %0; mov %0, %%cr3" : "=r"(cr3) : : "memory");
+}
+
+// The page table behind a directory slot, splitting a large page
+// into 1024 small ones with the same attributes. NULL if no memory.
+static u32 *paging_table(u32 addr) {
+    u32 *pde = &page_dir[addr >> 22];
+    if ((*pde & PG_PRESENT) && !(*pde & PG_LARGE))
+        return (u32 *)(*pde & ~0xFFFu);
+
+    u32 page = pmm_alloc_pages(0);
+    if (!page) return NULL;
+    u32 *pt = (u32 *)page;
+    if (*pde & PG_PRESENT) {
+        u32 base = *pde & ~(LARGE_SIZE - 1);
+        u32 attr = *pde & (PG_PRESENT | PG_WRITE | PG_CACHE);
+        for (u32 i = 0; i < 1024; i++)
+            pt[i] = (base + i * PAGE_SIZE) | attr;
+    } else {
+        kmemset(pt, 0, PAGE_SIZE);
+    }
+    *pde = page | PG_PRESENT | PG_WRITE;
+    return pt;
+}
+
+// Identity map [phys, phys+size) read/write with a PAGE_CACHE_*
+// type, replacing whatever mapped it before
+bool paging_map(u32 phys, u32 size, u32 cache) {
+    if (size == 0) return true;
+    u32 addr  = phys & ~(PAGE_SIZE - 1);
+    u32 pages = (size >> 12) + (((size & 0xFFF) + (phys - addr) + 0xFFF) >> 12);
+    cache &= PG_CACHE;
+    bool ok = true;
+
+    while (pages) {
+        u32 *big = &page_dir[addr >> 22];
+        if ((*big & PG_PRESENT) && (*big & PG_LARGE) && (*big & PG_CACHE) == cache) {
+            // Already mapped this way: don't split the large page
+            u32 n = 1024 - ((addr >> 12) & 1023);
+            if (n > pages) n = pages;
+            addr  += n * PAGE_SIZE;
+            pages -= n;
+            continue;
+        }
+        if (paging_pse && !(addr & (LARGE_SIZE - 1)) && pages >= 1024) {
+            u32 *pde = &page_dir[addr >> 22];
+            if ((*pde & PG_PRESENT) && !(*pde & PG_LARGE))
+                pmm_free_pages(*pde & ~0xFFFu, 0);
+            *pde = addr | PG_PRESENT | PG_WRITE | PG_LARGE | cache;
+            addr  += LARGE_SIZE;
+            pages -= 1024;
+            continue;
+        }
+        u32 *pt = paging_table(addr);
+        if (!pt) { ok = false; break; }
+        pt[(addr >> 12) & 1023] = addr | PG_PRESENT | PG_WRITE | cache;
+        addr += PAGE_SIZE;
+        pages--;
+    }
+    paging_flush();
+    return ok;
+}
+
+// Drivers: map a device's registers or memory, return its address
+void *paging_map_mmio(u32 phys, u32 size, u32 cache) {
+    return paging_map(phys, size, cache) ? (void *)phys : NULL;
+}
+
+// Any access to [addr, addr+size) now faults
+void paging_unmap(u32 addr, u32 size) {
+    u32 end = addr + size;
+    addr &= ~(PAGE_SIZE - 1);
+    while (addr < end) {
+        u32 *pde = &page_dir[addr >> 22];
+        if (!(*pde & PG_PRESENT)) {
+            addr = (addr | (LARGE_SIZE - 1)) + 1;
+        } else if ((*pde & PG_LARGE) && !(addr & (LARGE_SIZE - 1)) && end - addr >= LARGE_SIZE) {
+            *pde = 0;
+            addr += LARGE_SIZE;
+        } else {
+            u32 *pt = paging_table(addr);
+            if (pt) pt[(addr >> 12) & 1023] = 0;
+            addr += PAGE_SIZE;
+        }
+        if (addr == 0) break;       // wrapped past 4 GiB
+    }
+    paging_flush();
+}
+
+// Map all RAM write-back and switch paging on. Other physical
+// ranges (framebuffer, MMIO) are absent until a driver maps them.
+bool paging_init(void) {
+    if (cpu_paging_enabled()) return true;
+    paging_pse = cpu_has(CPUID_EDX_PSE);
+    u32 ram_end = pmm_phys_end();
+    if (ram_end == 0) return false;
+    pat_init();     // before any WC mapping exists; entry 1 = WC
+
+    if (!paging_map(0, ram_end, PAGE_CACHE_WB)) return false;
+    paging_unmap(0, PAGE_SIZE);     // NULL dereferences fault
+
+    u32 cr4;
+    __asm__ volatile ("mov %%cr4, %0" : "=r"(cr4));
+    if (paging_pse) cr4 |= CR4_PSE;
+    __asm__ volatile ("mov %0, %%cr4" : : "r"(cr4) : "memory");
+    __asm__ volatile ("mov %0, %%cr3" : : "r"(page_dir) : "memory");
+    u32 cr0;
+    __asm__ volatile ("mov %%cr0, %0" : "=r"(cr0));
+    __asm__ volatile ("mov %0, %%cr0" : : "r"(cr0 | CR0_PG) : "memory");
+    return true;
+}
+
+void paging_get_stats(paging_stats_t *st) {
+    st->large_pages = st->small_pages = st->tables = 0;
+    for (u32 i = 0; i < 1024; i++) {
+        u32 pde = page_dir[i];
+        if (!(pde & PG_PRESENT)) continue;
+        if (pde & PG_LARGE) {
+            st->large_pages++;
+            continue;
+        }
+        const u32 *pt = (const u32 *)(pde & ~0xFFFu);
+        st->tables++;
+        for (u32 k = 0; k < 1024; k++)
+            if (pt[k] & PG_PRESENT) st->small_pages++;
+    }
+}
@@ -0,0 +1,305 @@
+#include "../include/kernel.h"
+
+// ============================================================
+// PHYSICAL MEMORY MANAGER
+// Buddy allocator over 4 KiB page frames. Usable RAM comes from
+// the Multiboot memory map (MB1 mmap or MB2 tag 6); the low 1 MiB,
+// the kernel image, the framebuffer, boot modules and the boot
+// info itself are kept out. A free block of 2^order pages is
+// linked into free_area[order] through its own first bytes (RAM
+// is identity mapped) and its first frame's byte in pmm_meta says
+// "free, this order", so a freed block finds and merges its buddy
+// in O(1) per order. An allocated block's head says "used, this
+// order"; a free must match it exactly or it is ignored.
+// Boot modules are read straight from the (reserved) boot info, so
+// any number of them stays out; the fixed reservations fit a small
+// table, and overflowing it stops the boot rather than freeing
+// memory that is in use.
+// ============================================================
+#define PMM_MAX_REGIONS   32
+#define PMM_MAX_RESERVED  16
+#define PMM_FREE          0x80      // pmm_meta: head of a free block
+#define PMM_USED          0x40      // pmm_meta: head of an allocated block
+#define PMM_LOW_LIMIT     0x100000  // BIOS, VGA, real-mode leftovers
+
+extern u8 _kernel_start[], _kernel_end[];
+
+typedef struct pmm_block {
+    struct pmm_block *next, *prev;
+} pmm_block_t;
+
+typedef struct {
+    u32 start, end;     // [start, end), page aligned
+} pmm_range_t;
+
+static pmm_block_t *free_area[PMM_MAX_ORDER + 1];
+static u32          free_count[PMM_MAX_ORDER + 1];
+static u8          *pmm_meta = 0;       // one byte per frame below pmm_max_pfn
+static u32          pmm_max_pfn = 0;
+static u32          pmm_usable_pages = 0;
+static u32          pmm_free_count = 0;
+
+static pmm_range_t  avail[PMM_MAX_REGIONS];
+static int          n_avail = 0;
+static pmm_range_t  reserved[PMM_MAX_RESERVED];
+static int          n_reserved = 0;
+static multiboot_info_t *boot_mb1 = 0;  // module lists, see module_range()
+static mb2_info_t       *boot_mb2 = 0;
+
+// ============================================================
+// FREE LISTS
+// ============================================================
+static inline pmm_block_t *pfn_block(u32 pfn) {
+    return (pmm_block_t *)(pfn * PAGE_SIZE);
+}
+
+static void list_push(u32 pfn, u32 order) {
+    pmm_block_t *b = pfn_block(pfn);
+    b->prev = 0;
+    b->next = free_area[order];
+    if (b->next) b->next->prev = b;
+    free_area[order] = b;
+    free_count[order]++;
+    pmm_meta[pfn] = PMM_FREE | order;
+}
+
+static void list_remove(u32 pfn, u32 order) {
+    pmm_block_t *b = pfn_block(pfn);
+    if (b->prev) b->prev->next = b->next;
+    else         free_area[order] = b->next;
+    if (b->next) b->next->prev = b->prev;
+    free_count[order]--;
+    pmm_meta[pfn] = 0;
+}
+
+u32 pmm_alloc_pages(u32 order) {
+    if (order > PMM_MAX_ORDER) return 0;
+    u32 k = order;
+    while (k <= PMM_MAX_ORDER && !free_area[k]) k++;
+    if (k > PMM_MAX_ORDER) return 0;
+
+    u32 pfn = (u32)free_area[k] / PAGE_SIZE;
+    list_remove(pfn, k);
+    // Split down, giving back the upper halves
+    while (k > order) {
+        k--;
+        list_push(pfn + (1u << k), k);
+    }
+    pmm_meta[pfn] = PMM_USED | order;
+    pmm_free_count -= 1u << order;
+    return pfn * PAGE_SIZE;
+}
+
+void pmm_free_pages(u32 addr, u32 order) {
+    u32 pfn = addr / PAGE_SIZE;
+    // Only the exact head and order handed out by pmm_alloc_pages:
+    // double frees, tail pages and wrong orders are ignored
+    if (order > PMM_MAX_ORDER || pfn >= pmm_max_pfn ||
+        pmm_meta[pfn] != (PMM_USED | order))
+        return;
+    pmm_meta[pfn] = 0;
+    pmm_free_count += 1u << order;
+    while (order < PMM_MAX_ORDER) {
+        u32 buddy = pfn ^ (1u << order);
+        if (buddy >= pmm_max_pfn || pmm_meta[buddy] != (PMM_FREE | order)) break;
+        list_remove(buddy, order);
+        pfn &= ~(1u << order);
+        order++;
+    }
+    list_push(pfn, order);
+}
+
+// Hand [start, end) to the allocator in the largest aligned blocks
+static void release_range(u32 start, u32 end) {
+    u32 pfn = start / PAGE_SIZE, last = end / PAGE_SIZE;
+    while (pfn < last) {
+        u32 order = PMM_MAX_ORDER;
+        while (order > 0 && ((pfn & ((1u << order) - 1)) || pfn + (1u << order) > last))
+            order--;
+        pmm_meta[pfn] = PMM_USED | order;    // looks allocated, so the free takes it
+        pmm_free_pages(pfn * PAGE_SIZE, order);
+        pfn += 1u << order;
+    }
+}
+
+// ============================================================
+// MEMORY MAP
+// ============================================================
+static void add_avail(u64 addr, u64 len) {
+    u64 start = (addr + PAGE_SIZE - 1) & ~(u64)(PAGE_SIZE - 1);
+    u64 end   = (addr + len) & ~(u64)(PAGE_SIZE - 1);
+    if (end > 0xFFFFF000ull) end = 0xFFFFF000ull;    // 32-bit physical only
+    if (start >= end || n_avail == PMM_MAX_REGIONS) return;
+    avail[n_avail].start = (u32)start;
+    avail[n_avail].end   = (u32)end;
+    n_avail++;
+}
+
+// Whole pages covering [start, end)
+static void page_range(u32 start, u32 end, pmm_range_t *out) {
+    out->start = start & ~(PAGE_SIZE - 1);
+    out->end   = end > 0xFFFFF000u ? 0xFFFFF000u : (end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+}
+
+static void add_reserved(u32 start, u32 end) {
+    if (end <= start) return;
+    if (n_reserved == PMM_MAX_RESERVED)
+        kernel_panic("PMM: reserved range table full, cannot protect boot memory");
+    page_range(start, end, &reserved[n_reserved++]);
+}
+
+// Module k from the boot info; false past the last one
+static bool module_range(u32 k, pmm_range_t *out) {
+    if (boot_mb1) {
+        if (!(boot_mb1->flags & MB1_FLAG_MODS) || k >= boot_mb1->mods_count) return false;
+        const mb1_module_t *mod = (const mb1_module_t *)boot_mb1->mods_addr + k;
+        page_range(mod->mod_start, mod->mod_end, out);
+        return true;
+    }
+    if (!boot_mb2) return false;
+    u8 *tag_ptr = (u8 *)boot_mb2 + 8;
+    u8 *end_ptr = (u8 *)boot_mb2 + boot_mb2->total_size;
+    while (tag_ptr < end_ptr) {
+        mb2_tag_t *tag = (mb2_tag_t *)tag_ptr;
+        if (tag->type == 0) break;
+        if (tag->type == MB2_TAG_MODULE && k-- == 0) {
+            const mb2_tag_module_t *mod = (const mb2_tag_module_t *)tag;
+            page_range(mod->mod_start, mod->mod_end, out);
+            return true;
+        }
+        tag_ptr += (tag->size + 7) & ~7u;
+    }
+    return false;
+}
+
+// Reservation i: the table first, then every boot module
+static bool reserved_range(int i, pmm_range_t *out) {
+    if (i < n_reserved) {
+        *out = reserved[i];
+        return true;
+    }
+    return module_range((u32)(i - n_reserved), out);
+}
+
+static void parse_mb1(multiboot_info_t *mbi) {
+    add_reserved((u32)mbi, (u32)mbi + sizeof(*mbi));
+    if (mbi->flags & MB1_FLAG_MMAP) {
+        add_reserved(mbi->mmap_addr, mbi->mmap_addr + mbi->mmap_length);
+        u32 p = mbi->mmap_addr, end = mbi->mmap_addr + mbi->mmap_length;
+        while (p < end) {
+            mb1_mmap_entry_t *e = (mb1_mmap_entry_t *)p;
+            if (e->type == MMAP_AVAILABLE) add_avail(e->addr, e->len);
+            p += e->size + 4;   // size does not count itself
+        }
+    } else if (mbi->flags & MB1_FLAG_MEM) {
+        add_avail(PMM_LOW_LIMIT, (u64)mbi->mem_upper * 1024);
+    }
+    if (mbi->flags & MB1_FLAG_MODS) {
+        mb1_module_t *mod = (mb1_module_t *)mbi->mods_addr;
+        add_reserved((u32)mod, (u32)(mod + mbi->mods_count));
+        boot_mb1 = mbi;
+    }
+}
+
+static void parse_mb2(mb2_info_t *mb2) {
+    add_reserved((u32)mb2, (u32)mb2 + mb2->total_size);
+    boot_mb2 = mb2;
+    u8 *tag_ptr = (u8 *)mb2 + 8;
+    u8 *end_ptr = (u8 *)mb2 + mb2->total_size;
+    u32 mem_upper = 0;
+    bool have_mmap = false;
+
+    while (tag_ptr < end_ptr) {
+        mb2_tag_t *tag = (mb2_tag_t *)tag_ptr;
+        if (tag->type == 0) break;
+        if (tag->type == MB2_TAG_MMAP) {
+            mb2_tag_mmap_t *mm = (mb2_tag_mmap_t *)tag;
+            u8 *e = tag_ptr + sizeof(*mm);
+            for (; e + mm->entry_size <= tag_ptr + tag->size; e += mm->entry_size) {
+                mb2_mmap_entry_t *ent = (mb2_mmap_entry_t *)e;
+                if (ent->type == MMAP_AVAILABLE) add_avail(ent->addr, ent->len);
+            }
+            have_mmap = true;
+        } else if (tag->type == MB2_TAG_MEMINFO) {
+            mem_upper = ((mb2_tag_meminfo_t *)tag)->mem_upper;
+        }
+        u32 next = (tag->size + 7) & ~7u;
+        tag_ptr += next;
+    }
+    if (!have_mmap && mem_upper)
+        add_avail(PMM_LOW_LIMIT, (u64)mem_upper * 1024);
+}
+
+// Free [start, end) minus every reserved range
+static void release_unreserved(u32 start, u32 end) {
+    pmm_range_t r;
+    for (int i = 0; reserved_range(i, &r); i++) {
+        if (r.end <= r.start || r.start >= end || r.end <= start) continue;
+        if (start < r.start) release_unreserved(start, r.start);
+        if (r.end < end)     release_unreserved(r.end, end);
+        return;
+    }
+    release_range(start, end);
+}
+
+// Lowest unreserved stretch of usable RAM that holds size bytes
+static u32 find_hole(u32 size) {
+    for (int i = 0; i < n_avail; i++) {
+        u32 start = avail[i].start;
+        bool moved = true;
+        while (moved) {
+            moved = false;
+            pmm_range_t r;
+            for (int j = 0; reserved_range(j, &r); j++)
+                if (r.start < r.end && r.start < start + size && r.end > start) {
+                    start = r.end;
+                    moved = true;
+                }
+        }
+        if (start + size <= avail[i].end && start + size > start) return start;
+    }
+    return 0;
+}
+
+void pmm_init(u32 magic, void *mbi) {
+    add_reserved(0, PMM_LOW_LIMIT);
+    add_reserved((u32)_kernel_start, (u32)_kernel_end);
+    if (fb.addr) {
+        u32 fb_size = fb.vram_size > fb.pitch * fb.height ? fb.vram_size : fb.pitch * fb.height;
+        add_reserved((u32)fb.addr, (u32)fb.addr + fb_size);
+    }
+    if (magic == MBOOT2_MAGIC) parse_mb2((mb2_info_t *)mbi);
+    else if (magic == MBOOT1_MAGIC) parse_mb1((multiboot_info_t *)mbi);
+
+    for (int i = 0; i < n_avail; i++) {
+        pmm_usable_pages += (avail[i].end - avail[i].start) / PAGE_SIZE;
+        if (avail[i].end / PAGE_SIZE > pmm_max_pfn) pmm_max_pfn = avail[i].end / PAGE_SIZE;
+    }
+
+    // One metadata byte per frame, kept in the first hole that fits
+    u32 meta_size = (pmm_max_pfn + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    u32 meta = meta_size ? find_hole(meta_size) : 0;
+    if (!meta) {
+        pmm_max_pfn = 0;
+        return;
+    }
+    pmm_meta = (u8 *)meta;
+    kmemset(pmm_meta, 0, meta_size);
+    add_reserved(meta, meta + meta_size);
+
+    for (int i = 0; i < n_avail; i++)
+        release_unreserved(avail[i].start, avail[i].end);
+}
+
+// End of the highest usable frame
+u32 pmm_phys_end(void) {
+    return pmm_max_pfn * PAGE_SIZE;
+}
+
+void pmm_get_stats(pmm_stats_t *st) {
+    st->usable_pages = pmm_usable_pages;
+    st->free_pages   = pmm_free_count;
+    st->kernel_bytes = (u32)_kernel_end - (u32)_kernel_start;
+    for (int k = 0; k <= PMM_MAX_ORDER; k++)
+        st->free_blocks[k] = free_count[k];
+}
@@ -0,0 +1,148 @@
+#include "../include/kernel.h"
+
+// ============================================================
+// SAMPLING PROFILER
+// The RTC periodic interrupt (IRQ8, a power of two up to 8192 Hz)
+// takes each sample: the EIP it interrupted, read from the IRQ
+// stub's frame, is counted in a histogram of PROF_BUCKET-byte
+// buckets over kernel text. On request it also follows the saved
+// frame pointers for a short call stack; those only mean something
+// in a kernel built with `make PROF_STACKS=1`. prof_dump() sends
+// both to COM1 as text for tools/profsym.py to symbolize.
+// ============================================================
+#define PROF_BUCKET_SHIFT  4
+#define PROF_BUCKET        (1u << PROF_BUCKET_SHIFT)
+#define PROF_DEPTH         8
+#define PROF_MAX_STACKS    4096
+#define PROF_DEFAULT_HZ    1024
+
+extern u8 _text_start[], _text_end[];
+
+typedef struct {
+    u32 depth;
+    u32 pc[PROF_DEPTH];             // pc[0] is the sampled EIP
+} prof_stack_t;
+
+static u32 *prof_hist;
+static u32  prof_buckets;
+static prof_stack_t *prof_stacks;
+static volatile bool prof_running;
+static prof_stats_t stats;
+
+static bool prof_in_text(u32 pc) {
+    return pc >= (u32)_text_start && pc < (u32)_text_end;
+}
+
+// A frame pointer worth following: aligned and inside mapped RAM
+static bool prof_fp_ok(u32 fp) {
+    return !(fp & 3) && fp >= PAGE_SIZE && fp + 8 <= pmm_phys_end();
+}
+
+static void prof_free(void) {
+    kfree(prof_hist);
+    kfree(prof_stacks);
+    prof_hist = NULL;
+    prof_stacks = NULL;
+}
+
+// Sample at about hz (0: default, below 2 Hz the RTC's slowest)
+// into fresh buffers, the previous profile is dropped. Returns the
+// rate the RTC gave, 0 on failure.
+u32 prof_start(u32 hz, bool stacks) {
+    if (prof_running) return 0;
+    if (hz == 0) hz = PROF_DEFAULT_HZ;
+    if (hz < 2)  hz = 2;
+    prof_free();
+    kmemset(&stats, 0, sizeof(stats));
+    prof_buckets = ((u32)_text_end - (u32)_text_start + PROF_BUCKET - 1) >> PROF_BUCKET_SHIFT;
+    prof_hist = kmalloc(prof_buckets * sizeof(u32));
+    if (stacks) prof_stacks = kmalloc(PROF_MAX_STACKS * sizeof(prof_stack_t));
+    if (!prof_hist || (stacks && !prof_stacks)) {
+        prof_free();
+        return 0;
+    }
+    kmemset(prof_hist, 0, prof_buckets * sizeof(u32));
+    stats.stacks_on = stacks;
+    prof_running = true;
+    stats.hz = rtc_set_periodic(hz);
+    if (!stats.hz) {
+        prof_running = false;
+        prof_free();
+    }
+    return stats.hz;
+}
+
+void prof_stop(void) {
+    rtc_set_periodic(0);
+    prof_running = false;
+}
+
+// IRQ8 context, interrupts off
+void prof_sample(const irq_frame_t *f) {
+    if (!prof_running) return;
+    stats.samples++;
+    if (!prof_in_text(f->eip)) {
+        stats.outside++;
+        return;
+    }
+    prof_hist[(f->eip - (u32)_text_start) >> PROF_BUCKET_SHIFT]++;
+    if (!prof_stacks) return;
+    if (stats.stacks == PROF_MAX_STACKS) {
+        stats.dropped++;
+        return;
+    }
+
+    // Each frame: [fp] = caller's fp, [fp+4] = return address.
+    // Callers' frames sit higher up the stack; anything else ends it.
+    prof_stack_t *s = &prof_stacks[stats.stacks++];
+    s->pc[0] = f->eip;
+    s->depth = 1;
+    u32 fp = f->ebp;
+    while (s->depth < PROF_DEPTH && prof_fp_ok(fp)) {
+        const u32 *frame = (const u32 *)fp;
+        if (!prof_in_text(frame[1])) break;
+        s->pc[s->depth++] = frame[1];
+        if (frame[0] <= fp) break;
+        fp = frame[0];
+    }
+}
+
+void prof_get_stats(prof_stats_t *st) {
+    *st = stats;
+    st->running = prof_running;
+}
+
+// Text lines on COM1:
+//   profile <hz> <samples> <outside> <dropped>
+//   text <start> <bucket bytes>
+//   b <address> <count>         one per non-empty bucket
+//   s <pc0> <pc1> ...           one per stack, innermost first
+//   end
+// Returns false without a serial port.
+bool prof_dump(void) {
+    if (!serial_present() || !prof_hist) return false;
+    bool was = prof_running;
+    prof_running = false;           // a steady histogram while it is sent
+    char buf[128];
+    ksprintf(buf, "profile %u %u %u %u\n", stats.hz, stats.samples, stats.outside, stats.dropped);
+    serial_write(buf);
+    ksprintf(buf, "text 0x%x %u\n", (u32)_text_start, PROF_BUCKET);
+    serial_write(buf);
+    for (u32 i = 0; i < prof_buckets; i++) {
+        if (!prof_hist[i]) continue;
+        ksprintf(buf, "b 0x%x %u\n", (u32)_text_start + (i << PROF_BUCKET_SHIFT), prof_hist[i]);
+        serial_write(buf);
+    }
+    for (u32 i = 0; prof_stacks && i < stats.stacks; i++) {
+        const prof_stack_t *s = &prof_stacks[i];
+        serial_write("s");
+        for (u32 d = 0; d < s->depth; d++) {
+            ksprintf(buf, " 0x%x", s->pc[d]);
+            serial_write(buf);
+        }
+        serial_write("\n");
+    }
+    serial_write("end\n");
+    prof_running = was;
+    return true;
+}
@@ -0,0 +1,218 @@
+#include "../include/kernel.h"
+
+// ============================================================
+// SLAB ALLOCATOR
+// An object cache hands out fixed-size objects carved from
+// one-page slabs taken from the page allocator. Each slab starts
+// with a header (so kfree finds it by rounding the pointer down to
+// the page) followed by its objects; free objects are chained
+// through their first word. Slabs with free objects sit on the
+// cache's partial list, so alloc and free are O(1). kmalloc rounds
+// up to a power-of-two class cache; bigger requests get whole
+// pages with a small header of their own.
+// ============================================================
+#define KMEM_MAX_CACHES   24
+#define KMALLOC_MIN_SHIFT 4         // 16 bytes
+#define KMALLOC_MAX_SHIFT 10        // 1 KiB; above that, pages
+#define KMALLOC_CLASSES   (KMALLOC_MAX_SHIFT - KMALLOC_MIN_SHIFT + 1)
+#define SLAB_MAGIC        0x51AB51AB
+#define LARGE_MAGIC       0x1A46E000
+
+typedef struct slab {
+    u32           magic;
+    kmem_cache_t *cache;
+    struct slab  *next, *prev;      // on the cache's partial or full list
+    void         *free;             // chain of free objects
+    u32           inuse;
+} slab_t;
+
+typedef struct {
+    u32 magic;
+    u32 order;                      // pages = 2^order
+    u32 size;
+    u32 pad;
+} large_t;
+
+struct kmem_cache {
+    const char *name;
+    u32     size;                   // object size, rounded to 8
+    u32     per_slab;
+    u32     offset;                 // first object in the slab page
+    slab_t *partial;                // has free objects
+    slab_t *full;
+    slab_t *empty;                  // one spare, kept to avoid thrashing
+    u32     slabs;
+    u32     allocs, frees;
+    bool    used;
+};
+
+static kmem_cache_t caches[KMEM_MAX_CACHES];
+static kmem_cache_t *kmalloc_caches[KMALLOC_CLASSES];
+static const char *kmalloc_names[KMALLOC_CLASSES] = {
+    "kmalloc-16", "kmalloc-32", "kmalloc-64", "kmalloc-128",
+    "kmalloc-256", "kmalloc-512", "kmalloc-1024"
+};
+static u32 large_allocs, large_frees, large_pages;
+
+static void slab_unlink(slab_t **list, slab_t *s) {
+    if (s->prev) s->prev->next = s->next;
+    else         *list = s->next;
+    if (s->next) s->next->prev = s->prev;
+}
+
+static void slab_link(slab_t **list, slab_t *s) {
+    s->prev = 0;
+    s->next = *list;
+    if (*list) (*list)->prev = s;
+    *list = s;
+}
+
+static slab_t *slab_new(kmem_cache_t *c) {
+    u32 page = pmm_alloc_pages(0);
+    if (!page) return 0;
+    slab_t *s = (slab_t *)page;
+    s->magic = SLAB_MAGIC;
+    s->cache = c;
+    s->inuse = 0;
+    s->free  = 0;
+    // Chain back to front so objects come out in address order
+    for (u32 i = c->per_slab; i-- > 0; ) {
+        void **obj = (void **)(page + c->offset + i * c->size);
+        *obj = s->free;
+        s->free = obj;
+    }
+    c->slabs++;
+    return s;
+}
+
+kmem_cache_t *kmem_cache_create(const char *name, u32 size) {
+    size = (size + 7) & ~7u;
+    if (size < sizeof(void *)) size = sizeof(void *);
+    u32 offset = (sizeof(slab_t) + 15) & ~15u;
+    if (size > PAGE_SIZE - offset) return 0;
+
+    for (int i = 0; i < KMEM_MAX_CACHES; i++) {
+        kmem_cache_t *c = &caches[i];
+        if (c->used) continue;
+        kmemset(c, 0, sizeof(*c));
+        c->name     = name;
+        c->size     = size;
+        c->offset   = offset;
+        c->per_slab = (PAGE_SIZE - offset) / size;
+        c->used     = true;
+        return c;
+    }
+    return 0;
+}
+
+void *kmem_cache_alloc(kmem_cache_t *c) {
+    slab_t *s = c->partial;
+    if (!s) {
+        if (c->empty) { s = c->empty; c->empty = 0; }
+        else if (!(s = slab_new(c))) return 0;
+        slab_link(&c->partial, s);
+    }
+    void **obj = s->free;
+    s->free = *obj;
+    s->inuse++;
+    if (!s->free) {
+        slab_unlink(&c->partial, s);
+        slab_link(&c->full, s);
+    }
+    c->allocs++;
+    return obj;
+}
+
+void kmem_cache_free(kmem_cache_t *c, void *obj) {
+    slab_t *s = (slab_t *)((u32)obj & ~(PAGE_SIZE - 1));
+    if (s->magic != SLAB_MAGIC || s->cache != c) return;
+    if (!s->free) {
+        slab_unlink(&c->full, s);
+        slab_link(&c->partial, s);
+    }
+    *(void **)obj = s->free;
+    s->free = obj;
+    s->inuse--;
+    c->frees++;
+    if (s->inuse == 0) {
+        slab_unlink(&c->partial, s);
+        if (!c->empty) {
+            c->empty = s;
+        } else {
+            s->magic = 0;
+            c->slabs--;
+            pmm_free_pages((u32)s, 0);
+        }
+    }
+}
+
+void slab_init(void) {
+    for (int i = 0; i < KMALLOC_CLASSES; i++)
+        kmalloc_caches[i] = kmem_cache_create(kmalloc_names[i], 1u << (KMALLOC_MIN_SHIFT + i));
+}
+
+// ============================================================
+// KMALLOC / KFREE
+// ============================================================
+void *kmalloc(size_t size) {
+    if (size <= (1u << KMALLOC_MAX_SHIFT)) {
+        int cls = 0;
+        while ((1u << (KMALLOC_MIN_SHIFT + cls)) < size) cls++;
+        return kmalloc_caches[cls] ? kmem_cache_alloc(kmalloc_caches[cls]) : 0;
+    }
+    // Biggest block the PMM hands out; also keeps the shift and the
+    // header addition below from wrapping for absurd sizes
+    if (size > ((u32)PAGE_SIZE << PMM_MAX_ORDER) - sizeof(large_t)) return 0;
+    u32 order = 0;
+    while (((u32)PAGE_SIZE << order) < size + sizeof(large_t)) order++;
+    u32 page = pmm_alloc_pages(order);
+    if (!page) return 0;
+    large_t *h = (large_t *)page;
+    h->magic = LARGE_MAGIC;
+    h->order = order;
+    h->size  = size;
+    large_allocs++;
+    large_pages += 1u << order;
+    return h + 1;
+}
+
+void kfree(void *ptr) {
+    if (!ptr) return;
+    u32 page = (u32)ptr & ~(PAGE_SIZE - 1);
+    if (*(u32 *)page == SLAB_MAGIC) {
+        slab_t *s = (slab_t *)page;
+        kmem_cache_free(s->cache, ptr);
+    } else if (*(u32 *)page == LARGE_MAGIC && (large_t *)ptr == (large_t *)page + 1) {
+        large_t *h = (large_t *)page;
+        h->magic = 0;
+        large_frees++;
+        large_pages -= 1u << h->order;
+        pmm_free_pages(page, h->order);
+    }
+}
+
+// Counters of the i-th cache; false past the last one. The
+// entry after the caches covers the page-sized kmalloc blocks.
+bool kmem_cache_stats(int i, kmem_stats_t *st) {
+    for (int k = 0; k < KMEM_MAX_CACHES; k++) {
+        const kmem_cache_t *c = &caches[k];
+        if (!c->used || i-- > 0) continue;
+        st->name     = c->name;
+        st->size     = c->size;
+        st->active   = c->allocs - c->frees;
+        st->total    = c->slabs * c->per_slab;
+        st->pages    = c->slabs;
+        st->allocs   = c->allocs;
+        st->frees    = c->frees;
+        return true;
+    }
+    if (i != 0) return false;
+    st->name   = "kmalloc-large";
+    st->size   = 0;
+    st->active = large_allocs - large_frees;
+    st->total  = st->active;
+    st->pages  = large_pages;
+    st->allocs = large_allocs;
+    st->frees  = large_frees;
+    return true;
+}
@@ -0,0 +1,135 @@
+#include "../include/kernel.h"
+
+// ============================================================
+// EVENT TRACE
+// Static tracepoints (TRACE() in kernel.h) append fixed 16-byte
+// records, TSC-stamped, to a per-CPU ring; this kernel runs on one
+// CPU, so there is one ring. A slot is claimed with one xadd, which
+// an interrupt cannot split, so IRQ handlers and the code they
+// interrupt never need a lock. The ring keeps the newest
+// TRACE_EVENTS records. While tracing is off a tracepoint is a load
+// and a not-taken branch.
+// ============================================================
+#define TRACE_CPUS      1
+#define TRACE_ORDER     6                               // 256 KiB per CPU
+#define TRACE_EVENTS    (((u32)PAGE_SIZE << TRACE_ORDER) / sizeof(trace_rec_t))
+
+typedef struct {
+    u64 tsc;
+    u16 event;
+    u16 a;
+    u32 b;
+} trace_rec_t;
+
+typedef struct {
+    trace_rec_t *buf;
+    u32 head;                       // records ever written
+} trace_ring_t;
+
+// How the host shows each event: name ("{a}" takes argument a),
+// Chrome trace phase (B/E: begin/end of a span, i: instant), and
+// the names of arguments a and b ("-": unused)
+typedef struct {
+    const char *name;
+    char ph;
+    const char *arg_a, *arg_b;
+} trace_info_t;
+
+static const trace_info_t trace_info[TRACE_EVENT_COUNT] = {
+    [TRACE_IRQ_ENTER]    = { "irq{a}",         'B', "-",    "-" },
+    [TRACE_IRQ_EXIT]     = { "irq{a}",         'E', "-",    "-" },
+    [TRACE_KEY]          = { "key",            'i', "char", "dropped" },
+    [TRACE_APP_START]    = { "app{a}",         'B', "-",    "-" },
+    [TRACE_APP_EXIT]     = { "app{a}",         'E', "-",    "-" },
+    [TRACE_FB_FILL]      = { "fb_fill_rect",   'i', "w",    "h" },
+    [TRACE_FB_TEXT]      = { "fb_draw_string", 'i', "w",    "h" },
+    [TRACE_FB_CIRCLE]    = { "fb_fill_circle", 'i', "w",    "h" },
+    [TRACE_FB_PRESENT]   = { "fb_present",     'B', "-",    "rects" },
+    [TRACE_FB_PRESENTED] = { "fb_present",     'E', "-",    "-" },
+};
+
+static trace_ring_t trace_rings[TRACE_CPUS];
+bool trace_on = false;
+
+static inline u32 trace_cpu(void) {
+    return 0;
+}
+
+void trace_emit(u32 event, u32 a, u32 b) {
+    trace_ring_t *r = &trace_rings[trace_cpu()];
+    // An IRQ between the clock read and the xadd takes an earlier slot
+    // with a later stamp, so the ring is only nearly in time order;
+    // trace2json.py sorts by tsc
+    u64 now = rdtsc();
+    u32 i = 1;
+    __asm__ volatile ("xaddl %0, %1" : "+r"(i), "+m"(r->head) : : "memory");
+    trace_rec_t *e = &r->buf[i % TRACE_EVENTS];
+    e->tsc   = now;
+    e->event = (u16)event;
+    e->a     = (u16)a;
+    e->b     = b;
+}
+
+// Empty the rings and start recording; needs the TSC and its rate
+bool trace_start(void) {
+    if (!clocksource_tsc_khz()) return false;
+    trace_on = false;
+    for (u32 c = 0; c < TRACE_CPUS; c++) {
+        trace_ring_t *r = &trace_rings[c];
+        if (!r->buf) r->buf = (trace_rec_t *)pmm_alloc_pages(TRACE_ORDER);
+        if (!r->buf) return false;
+        r->head = 0;
+    }
+    trace_on = true;
+    return true;
+}
+
+void trace_stop(void) {
+    trace_on = false;
+}
+
+void trace_get_stats(trace_stats_t *st) {
+    st->running = trace_on;
+    st->events = st->lost = 0;
+    for (u32 c = 0; c < TRACE_CPUS; c++) {
+        u32 n = trace_rings[c].head;
+        st->events += n < TRACE_EVENTS ? n : TRACE_EVENTS;
+        st->lost   += n > TRACE_EVENTS ? n - TRACE_EVENTS : 0;
+    }
+}
+
+// On COM1, for tools/trace2json.py:
+//   trace <cpus> <tsc kHz> <event types>
+//   event <id> <ph> <name> <arg a> <arg b>     one per event type
+//   cpu <n> <records> <lost>                   then the raw records,
+//                                              oldest first, and '\n'
+//   end
+// Tracing is paused while the rings are sent.
+bool trace_dump(void) {
+    if (!serial_present() || !trace_rings[0].buf) return false;
+    bool was = trace_on;
+    trace_on = false;
+    char buf[96];
+    ksprintf(buf, "trace %u %u %u\n", TRACE_CPUS, clocksource_tsc_khz(), TRACE_EVENT_COUNT);
+    serial_write(buf);
+    for (u32 i = 0; i < TRACE_EVENT_COUNT; i++) {
+        const trace_info_t *t = &trace_info[i];
+        ksprintf(buf, "event %u %c %s %s %s\n", i, t->ph, t->name, t->arg_a, t->arg_b);
+        serial_write(buf);
+    }
+    for (u32 c = 0; c < TRACE_CPUS; c++) {
+        const trace_ring_t *r = &trace_rings[c];
+        u32 n = r->head < TRACE_EVENTS ? r->head : TRACE_EVENTS;
+        u32 first = r->head - n;
+        ksprintf(buf, "cpu %u %u %u\n", c, n, first);
+        serial_write(buf);
+        for (u32 i = 0; i < n; i++) {
+            const u8 *p = (const u8 *)&r->buf[(first + i) % TRACE_EVENTS];
+            for (u32 k = 0; k < sizeof(trace_rec_t); k++) serial_putc((char)p[k]);
+        }
+        serial_write("\n");
+    }
+    serial_write("end\n");
+    trace_on = was;
+    return true;
+}
@@ -0,0 +1,222 @@
+#include "../include/kernel.h"
+
+// ============================================================
+// WINDOW MANAGER
+// Windows are stacked bottom to top over the desktop. Each one
+// keeps its visible region: its frame minus the frames of every
+// window above it, as a list of disjoint rects. All drawing for a
+// window goes through a display list limited to that region, so
+// covered parts cost nothing. Closing, moving or raising a window
+// repaints only the area that changed owner.
+// Regions never lose pieces and never grow past their area: every
+// piece edge lies on a window frame (current, or the old one of a
+// moved window), a repaint rect or the screen, which bounds the
+// piece count at WM_REGION_MAX. Scratch regions are static: the WM
+// runs on one thread and never nests.
+// ============================================================
+#define WM_REGION_MAX   ((2 * WM_MAX_WINDOWS + 5) * (2 * WM_MAX_WINDOWS + 5))
+
+typedef struct {
+    fb_rect_t r[WM_REGION_MAX];
+    int n;
+} wm_region_t;
+
+static wm_window_t  wm_slots[WM_MAX_WINDOWS];
+static wm_window_t *wm_stack[WM_MAX_WINDOWS];  // [0] = bottom
+static int          wm_count = 0;
+static void       (*wm_background)(void) = 0;
+
+// ============================================================
+// RECT REGIONS
+// ============================================================
+static void region_add(wm_region_t *g, int x, int y, int w, int h) {
+    if (w <= 0 || h <= 0 || g->n == WM_REGION_MAX) return;   // bounded, see top
+    fb_rect_t r = { x, y, w, h };
+    g->r[g->n++] = r;
+}
+
+// g -= cut. Each piece splits into up to four: bands above and
+// below the cut, then the parts left and right of it.
+static void region_subtract(wm_region_t *g, const fb_rect_t *cut) {
+    static wm_region_t out;
+    out.n = 0;
+    for (int i = 0; i < g->n; i++) {
+        const fb_rect_t *p = &g->r[i];
+        fb_rect_t in;
+        if (!fb_rect_intersect(p, cut, &in)) {
+            region_add(&out, p->x, p->y, p->w, p->h);
+            continue;
+        }
+        region_add(&out, p->x, p->y, p->w, in.y - p->y);
+        region_add(&out, p->x, in.y + in.h, p->w, p->y + p->h - (in.y + in.h));
+        region_add(&out, p->x, in.y, in.x - p->x, in.h);
+        region_add(&out, in.x + in.w, in.y, p->x + p->w - (in.x + in.w), in.h);
+    }
+    *g = out;
+}
+
+// out = a & b
+static void region_intersect(const fb_rect_t *a, int na, const fb_rect_t *b, int nb,
+                             wm_region_t *out) {
+    out->n = 0;
+    for (int i = 0; i < na; i++)
+        for (int j = 0; j < nb; j++) {
+            fb_rect_t in;
+            if (fb_rect_intersect(&a[i], &b[j], &in))
+                region_add(out, in.x, in.y, in.w, in.h);
+        }
+}
+
+// ============================================================
+// STACK
+// ============================================================
+static int wm_index(const wm_window_t *w) {
+    for (int i = 0; i < wm_count; i++)
+        if (wm_stack[i] == w) return i;
+    return -1;
+}
+
+static void wm_update_clips(void) {
+    fb_rect_t screen = { 0, 0, (int)fb.width, (int)fb.height };
+    for (int i = 0; i < wm_count; i++) {
+        wm_window_t *w = wm_stack[i];
+        static wm_region_t g;
+        g.n = 0;
+        fb_rect_t r;
+        if (fb_rect_intersect(&w->frame, &screen, &r))
+            region_add(&g, r.x, r.y, r.w, r.h);
+        for (int j = i + 1; j < wm_count && g.n; j++)
+            region_subtract(&g, &wm_stack[j]->frame);
+        for (int k = 0; k < g.n; k++) w->clip[k] = g.r[k];
+        w->n_clip = g.n;
+    }
+}
+
+static void wm_paint_window(wm_window_t *w, const fb_rect_t *rects, int n) {
+    if (n == 0 || !w->paint) return;
+    fb_list_begin_region(rects, n);
+    w->paint(w);
+    fb_list_end();
+}
+
+// Repaint an area from the bottom up: the desktop where no window
+// covers it, then each window's visible share of it
+static void wm_paint_area(const fb_rect_t *area, int n_area) {
+    static wm_region_t g;
+    g.n = 0;
+    for (int i = 0; i < n_area; i++)
+        region_add(&g, area[i].x, area[i].y, area[i].w, area[i].h);
+    for (int i = 0; i < wm_count && g.n; i++)
+        region_subtract(&g, &wm_stack[i]->frame);
+    if (g.n && wm_background) {
+        fb_list_begin_region(g.r, g.n);
+        wm_background();
+        fb_list_end();
+    }
+    for (int i = 0; i < wm_count; i++) {
+        region_intersect(wm_stack[i]->clip, wm_stack[i]->n_clip, area, n_area, &g);
+        wm_paint_window(wm_stack[i], g.r, g.n);
+    }
+}
+
+void wm_set_background(void (*paint)(void)) {
+    wm_background = paint;
+}
+
+wm_window_t *wm_open(int x, int y, int w, int h, const char *title,
+                     void (*paint)(wm_window_t *w)) {
+    if (wm_count == WM_MAX_WINDOWS) return NULL;
+    wm_window_t *win = NULL;
+    for (int i = 0; i < WM_MAX_WINDOWS && !win; i++)
+        if (!wm_slots[i].open) win = &wm_slots[i];
+
+    fb_rect_t frame = { x, y, w, h };
+    win->frame  = frame;
+    win->title  = title;
+    win->paint  = paint;
+    win->open   = true;
+    wm_stack[wm_count++] = win;
+    wm_update_clips();
+    wm_paint_window(win, win->clip, win->n_clip);
+    return win;
+}
+
+void wm_close(wm_window_t *w) {
+    int idx = wm_index(w);
+    if (idx < 0) return;
+    static wm_region_t exposed;
+    exposed.n = w->n_clip;
+    for (int i = 0; i < w->n_clip; i++) exposed.r[i] = w->clip[i];
+
+    for (int i = idx; i < wm_count - 1; i++)
+        wm_stack[i] = wm_stack[i + 1];
+    wm_count--;
+    w->open = false;
+    w->n_clip = 0;
+    wm_update_clips();
+    wm_paint_area(exposed.r, exposed.n);
+}
+
+// Move and/or resize. The window is redrawn where it is now visible;
+// of its old area only what it no longer covers is repainted.
+void wm_set_frame(wm_window_t *w, int x, int y, int width, int height) {
+    if (wm_index(w) < 0) return;
+    static wm_region_t exposed;
+    exposed.n = w->n_clip;
+    for (int i = 0; i < w->n_clip; i++) exposed.r[i] = w->clip[i];
+
+    fb_rect_t frame = { x, y, width, height };
+    w->frame = frame;
+    wm_update_clips();
+    region_subtract(&exposed, &w->frame);
+    wm_paint_window(w, w->clip, w->n_clip);
+    wm_paint_area(exposed.r, exposed.n);
+}
+
+// Bring to the top and paint just the parts that were covered
+void wm_raise(wm_window_t *w) {
+    int idx = wm_index(w);
+    if (idx < 0 || idx == wm_count - 1) return;
+    static wm_region_t newly;
+    newly.n = 0;
+    region_add(&newly, w->frame.x, w->frame.y, w->frame.w, w->frame.h);
+    for (int i = 0; i < w->n_clip; i++)
+        region_subtract(&newly, &w->clip[i]);
+
+    for (int i = idx; i < wm_count - 1; i++)
+        wm_stack[i] = wm_stack[i + 1];
+    wm_stack[wm_count - 1] = w;
+    wm_update_clips();
+    static wm_region_t paint;
+    region_intersect(w->clip, w->n_clip, newly.r, newly.n, &paint);
+    wm_paint_window(w, paint.r, paint.n);
+}
+
+void wm_repaint(const fb_rect_t *r) {
+    fb_rect_t screen = { 0, 0, (int)fb.width, (int)fb.height };
+    wm_update_clips();      // the mode may have changed
+    wm_paint_area(r ? r : &screen, 1);
+}
+
+// ============================================================
+// DRAWING INTO A WINDOW
+// Everything between wm_begin() and wm_end() is clipped to the
+// window's visible region. The stack must not change in between.
+// ============================================================
+void wm_begin(wm_window_t *w) {
+    fb_list_begin_region(w->clip, w->n_clip);
+}
+
+void wm_end(void) {
+    fb_list_end();
+}
+
+bool wm_visible(const wm_window_t *w, const fb_rect_t *r) {
+    for (int i = 0; i < w->n_clip; i++) {
+        const fb_rect_t *c = &w->clip[i];
+        if (r->x >= c->x && r->y >= c->y &&
+            r->x + r->w <= c->x + c->w && r->y + r->h <= c->y + c->h)
+            return true;
+    }
+    return false;
+}
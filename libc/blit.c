@@ -0,0 +1,145 @@
+// ============================================================
+// ArcticOS - Bulk fill/copy kernels
+// SSE2 (128-bit, optional non-temporal stores) or scalar,
+// picked once at boot from CPUID by blit_init().
+// ============================================================
+
+#include "../include/kernel.h"
+
+// ============================================================
+// SCALAR FALLBACK
+// ============================================================
+static void fill32_scalar(void *dst, u32 val, size_t count) {
+    u32 *d = dst;
+    while (count--) *d++ = val;
+}
+
+static void copy_scalar(void *dst, const void *src, size_t n) {
+    u8 *d = dst;
+    const u8 *s = src;
+    while (n && ((u32)d & 3)) { *d++ = *s++; n--; }
+    u32 *dw = (u32 *)d;
+    const u32 *sw = (const u32 *)s;
+    for (; n >= 4; n -= 4) *dw++ = *sw++;
+    d = (u8 *)dw; s = (const u8 *)sw;
+    while (n--) *d++ = *s++;
+}
+
+// ============================================================
+// SSE2
+// Only ever called once cpu_enable_sse() has set CR4.OSFXSR,
+// so these may use XMM registers freely.
+// ============================================================
+#define SSE2 __attribute__((target("sse2")))
+
+SSE2 static void fill32_sse2_impl(void *dst, u32 val, size_t count, bool stream) {
+    u32 *d = dst;
+    if ((u32)d & 3) { fill32_scalar(dst, val, count); return; }
+    while (count && ((u32)d & 15)) { *d++ = val; count--; }
+
+    size_t blocks = count / 16;             // 64 bytes per iteration
+    if (blocks && stream) {
+        __asm__ volatile (
+            "movd %2, %%xmm0\n\t"
+            "pshufd $0, %%xmm0, %%xmm0\n"
+            "1:\n\t"
+            "movntdq %%xmm0,   (%0)\n\t"
+            "movntdq %%xmm0, 16(%0)\n\t"
+            "movntdq %%xmm0, 32(%0)\n\t"
+            "movntdq %%xmm0, 48(%0)\n\t"
+            "add $64, %0\n\t"
+            "dec %1\n\t"
+            "jnz 1b\n\t"
+            "sfence"
+            : "+r"(d), "+r"(blocks) : "r"(val) : "xmm0", "memory", "cc");
+    } else if (blocks) {
+        __asm__ volatile (
+            "movd %2, %%xmm0\n\t"
+            "pshufd $0, %%xmm0, %%xmm0\n"
+            "1:\n\t"
+            "movdqa %%xmm0,   (%0)\n\t"
+            "movdqa %%xmm0, 16(%0)\n\t"
+            "movdqa %%xmm0, 32(%0)\n\t"
+            "movdqa %%xmm0, 48(%0)\n\t"
+            "add $64, %0\n\t"
+            "dec %1\n\t"
+            "jnz 1b"
+            : "+r"(d), "+r"(blocks) : "r"(val) : "xmm0", "memory", "cc");
+    }
+    count &= 15;
+    while (count--) *d++ = val;
+}
+
+SSE2 static void copy_sse2_impl(void *dst, const void *src, size_t n, bool stream) {
+    u8 *d = dst;
+    const u8 *s = src;
+    while (n && ((u32)d & 15)) { *d++ = *s++; n--; }
+
+    size_t blocks = n / 64;
+    if (blocks && stream) {
+        __asm__ volatile (
+            "1:\n\t"
+            "movdqu   (%1), %%xmm0\n\t"
+            "movdqu 16(%1), %%xmm1\n\t"
+            "movdqu 32(%1), %%xmm2\n\t"
+            "movdqu 48(%1), %%xmm3\n\t"
+            "movntdq %%xmm0,   (%0)\n\t"
+            "movntdq %%xmm1, 16(%0)\n\t"
+            "movntdq %%xmm2, 32(%0)\n\t"
+            "movntdq %%xmm3, 48(%0)\n\t"
+            "add $64, %0\n\t"
+            "add $64, %1\n\t"
+            "dec %2\n\t"
+            "jnz 1b\n\t"
+            "sfence"
+            : "+r"(d), "+r"(s), "+r"(blocks)
+            : : "xmm0", "xmm1", "xmm2", "xmm3", "memory", "cc");
+    } else if (blocks) {
+        __asm__ volatile (
+            "1:\n\t"
+            "movdqu   (%1), %%xmm0\n\t"
+            "movdqu 16(%1), %%xmm1\n\t"
+            "movdqu 32(%1), %%xmm2\n\t"
+            "movdqu 48(%1), %%xmm3\n\t"
+            "movdqa %%xmm0,   (%0)\n\t"
+            "movdqa %%xmm1, 16(%0)\n\t"
+            "movdqa %%xmm2, 32(%0)\n\t"
+            "movdqa %%xmm3, 48(%0)\n\t"
+            "add $64, %0\n\t"
+            "add $64, %1\n\t"
+            "dec %2\n\t"
+            "jnz 1b"
+            : "+r"(d), "+r"(s), "+r"(blocks)
+            : : "xmm0", "xmm1", "xmm2", "xmm3", "memory", "cc");
+    }
+    copy_scalar(d, s, n & 63);
+}
+
+static void fill32_sse2(void *dst, u32 val, size_t count)        { fill32_sse2_impl(dst, val, count, false); }
+static void stream_fill32_sse2(void *dst, u32 val, size_t count) { fill32_sse2_impl(dst, val, count, true); }
+static void copy_sse2(void *dst, const void *src, size_t n)        { copy_sse2_impl(dst, src, n, false); }
+static void stream_copy_sse2(void *dst, const void *src, size_t n) { copy_sse2_impl(dst, src, n, true); }
+
+// ============================================================
+// DISPATCH
+// ============================================================
+void (*blit_fill32)(void *dst, u32 val, size_t count)        = fill32_scalar;
+void (*blit_stream_fill32)(void *dst, u32 val, size_t count) = fill32_scalar;
+void (*blit_copy)(void *dst, const void *src, size_t n)        = copy_scalar;
+void (*blit_stream_copy)(void *dst, const void *src, size_t n) = copy_scalar;
+
+static const char *blit_impl = "scalar";
+
+void blit_init(void) {
+    if (cpu_sse_enabled() && cpu_has(CPUID_EDX_SSE2)) {
+        blit_fill32        = fill32_sse2;
+        blit_stream_fill32 = stream_fill32_sse2;
+        blit_copy          = copy_sse2;
+        blit_stream_copy   = stream_copy_sse2;
+        blit_impl = "sse2";
+    }
+}
+
+const char *blit_impl_name(void) {
+    return blit_impl;
+}
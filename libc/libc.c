@@ -30,19 +30,79 @@ int kstrncmp(const char *a, const char *b, int n) {
     return (u8)*a - (u8)*b;
 }
 
+// Memory: bytes up to a 4-byte aligned destination, then rep stosd /
+// rep movsd for the bulk, then the last 0-3 bytes. Short runs stay
+// byte loops: setting up a rep string costs more than they do.
+#define MEM_REP_MIN 16
+
 void *kmemset(void *ptr, int val, size_t n) {
     u8 *p = ptr;
+    if (n >= MEM_REP_MIN) {
+        while ((u32)p & 3) { *p++ = (u8)val; n--; }
+        u32 dw = n / 4;
+        u32 pattern = (u8)val * 0x01010101u;
+        __asm__ volatile ("rep stosl" : "+D"(p), "+c"(dw) : "a"(pattern) : "memory");
+        n &= 3;
+    }
     while (n--) *p++ = (u8)val;
     return ptr;
 }
 
+// count 32-bit values, e.g. pixels
+void *kmemset32(void *ptr, u32 val, size_t count) {
+    u32 *p = ptr;
+    __asm__ volatile ("rep stosl" : "+D"(p), "+c"(count) : "a"(val) : "memory");
+    return ptr;
+}
+
 void *kmemcpy(void *dst, const void *src, size_t n) {
     u8 *d = dst;
     const u8 *s = src;
+    if (n >= MEM_REP_MIN) {
+        while ((u32)d & 3) { *d++ = *s++; n--; }
+        u32 dw = n / 4;
+        __asm__ volatile ("rep movsl" : "+D"(d), "+S"(s), "+c"(dw) : : "memory");
+        n &= 3;
+    }
     while (n--) *d++ = *s++;
     return dst;
 }
 
+// Overlap-safe: with dst above src it copies from the end down
+// (direction flag set for the rep movsd, cleared again after)
+void *kmemmove(void *dst, const void *src, size_t n) {
+    u8 *d = dst;
+    const u8 *s = src;
+    if (d <= s || d >= s + n) return kmemcpy(dst, src, n);
+
+    d += n;
+    s += n;
+    if (n >= MEM_REP_MIN) {
+        while ((u32)d & 3) { *--d = *--s; n--; }
+        u32 dw = n / 4;
+        d -= 4;
+        s -= 4;
+        __asm__ volatile ("std\n\trep movsl\n\tcld"
+                          : "+D"(d), "+S"(s), "+c"(dw) : : "memory");
+        d += 4;
+        s += 4;
+        n &= 3;
+    }
+    while (n--) *--d = *--s;
+    return dst;
+}
+
+// 64-by-32 division in two divl steps (no libgcc here)
+u64 kdiv64(u64 n, u32 d, u32 *rem) {
+    u32 hi = (u32)(n >> 32), lo = (u32)n;
+    u32 q_hi = hi / d;
+    hi %= d;
+    u32 q_lo, r;
+    __asm__ ("divl %4" : "=a"(q_lo), "=d"(r) : "a"(lo), "d"(hi), "rm"(d));
+    if (rem) *rem = r;
+    return ((u64)q_hi << 32) | q_lo;
+}
+
 void kitoa(i32 val, char *buf, int base) {
     char tmp[32];
     int i = 0, neg = 0;
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Symbolize an ArcticOS profiler dump (`prof dump`, sent over COM1).
+
+Prints a flat profile by function and, with --folded, writes the call
+stacks in the folded format flamegraph.pl and speedscope read:
+
+    python3 tools/profsym.py build/profile.txt --folded build/profile.folded
+    flamegraph.pl build/profile.folded > profile.svg
+
+Symbols come from `nm -n` on the kernel ELF (build/arcticos.elf).
+"""
+import argparse
+import bisect
+import collections
+import subprocess
+import sys
+
+
+def load_symbols(elf, nm):
+    out = subprocess.run([nm, "-n", "--defined-only", elf],
+                         check=True, capture_output=True, text=True).stdout
+    addrs, names = [], []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) == 3 and parts[1] in "tTwW":
+            addrs.append(int(parts[0], 16))
+            names.append(parts[2])
+    return addrs, names
+
+
+def symbolize(addrs, names, pc):
+    i = bisect.bisect_right(addrs, pc) - 1
+    return names[i] if i >= 0 else "0x%x" % pc
+
+
+def read_dump(path):
+    """The last complete profile in the file (serial logs may hold several)."""
+    profile, cur = None, None
+    with open(path, errors="replace") as f:
+        for line in f:
+            parts = line.split()
+            if not parts:
+                continue
+            if parts[0] == "profile" and len(parts) == 5:
+                cur = {"hz": int(parts[1]), "samples": int(parts[2]),
+                       "outside": int(parts[3]), "dropped": int(parts[4]),
+                       "buckets": [], "stacks": []}
+            elif cur is None:
+                continue
+            elif parts[0] == "b":
+                cur["buckets"].append((int(parts[1], 16), int(parts[2])))
+            elif parts[0] == "s":
+                cur["stacks"].append([int(p, 16) for p in parts[1:]])
+            elif parts[0] == "end":
+                profile, cur = cur, None
+    return profile
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("dump", help="serial output containing a profile")
+    ap.add_argument("--elf", default="build/arcticos.elf")
+    ap.add_argument("--nm", default="nm")
+    ap.add_argument("--folded", metavar="FILE", help="write folded call stacks")
+    ap.add_argument("--top", type=int, default=30, help="functions to list")
+    args = ap.parse_args()
+
+    prof = read_dump(args.dump)
+    if prof is None:
+        sys.exit("%s: no complete profile (profile ... end) found" % args.dump)
+    addrs, names = load_symbols(args.elf, args.nm)
+
+    flat = collections.Counter()
+    for addr, count in prof["buckets"]:
+        flat[symbolize(addrs, names, addr)] += count
+    total = sum(flat.values())
+    print("%d samples at %d Hz, %d outside kernel text"
+          % (prof["samples"], prof["hz"], prof["outside"]))
+    print("%7s %8s  %s" % ("%", "samples", "function"))
+    for name, count in flat.most_common(args.top):
+        print("%6.2f%% %8d  %s" % (100.0 * count / max(total, 1), count, name))
+
+    if args.folded:
+        folded = collections.Counter()
+        for stack in prof["stacks"]:
+            # Innermost first; return addresses point past the call
+            frames = [symbolize(addrs, names, stack[0])]
+            frames += [symbolize(addrs, names, pc - 1) for pc in stack[1:]]
+            folded[";".join(reversed(frames))] += 1
+        with open(args.folded, "w") as f:
+            for stack, count in sorted(folded.items()):
+                f.write("%s %d\n" % (stack, count))
+        print("%d stacks (%d dropped) -> %s"
+              % (len(prof["stacks"]), prof["dropped"], args.folded))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Convert an ArcticOS event trace (`trace dump`, sent over COM1) to
+Chrome trace JSON, which ui.perfetto.dev and chrome://tracing open:
+
+    python3 tools/trace2json.py build/trace.bin -o build/trace.json
+
+The dump is a text header followed by raw 16-byte records per CPU
+(u64 TSC, u16 event, u16 a, u32 b, little endian); see kernel/trace.c.
+"""
+import argparse
+import json
+import struct
+import sys
+
+REC = struct.Struct("<QHHI")
+
+
+def read_line(data, pos):
+    end = data.index(b"\n", pos)
+    return data[pos:end].decode("ascii", "replace").split(), end + 1
+
+
+def parse(data):
+    """The last complete trace in the capture."""
+    start = data.rfind(b"trace ")
+    while start > 0 and data[start - 1:start] != b"\n":
+        start = data.rfind(b"trace ", 0, start)
+    if start < 0:
+        raise ValueError("no trace header found")
+    hdr, pos = read_line(data, start)
+    cpus, khz, ntypes = int(hdr[1]), int(hdr[2]), int(hdr[3])
+
+    events = {}
+    for _ in range(ntypes):
+        f, pos = read_line(data, pos)
+        events[int(f[1])] = {"ph": f[2], "name": f[3], "a": f[4], "b": f[5]}
+
+    records = []
+    for _ in range(cpus):
+        f, pos = read_line(data, pos)
+        cpu, n = int(f[1]), int(f[2])
+        raw = data[pos:pos + n * REC.size]
+        if len(raw) < n * REC.size:
+            raise ValueError("trace cut short on cpu %d" % cpu)
+        records += [(cpu,) + REC.unpack_from(raw, i * REC.size) for i in range(n)]
+        pos += n * REC.size + 1
+    return khz, events, records
+
+
+def to_chrome(khz, events, records):
+    out = []
+    t0 = min((r[1] for r in records), default=0)
+    for cpu, tsc, ev, a, b in sorted(records, key=lambda r: r[1]):
+        info = events.get(ev, {"ph": "i", "name": "event%d" % ev, "a": "a", "b": "b"})
+        e = {"name": info["name"].replace("{a}", str(a)), "ph": info["ph"],
+             "ts": (tsc - t0) * 1000.0 / khz, "pid": 0, "tid": cpu}
+        args = {}
+        if info["a"] != "-":
+            args[info["a"]] = chr(a) if info["a"] == "char" and 32 <= a < 127 else a
+        if info["b"] != "-":
+            args[info["b"]] = b
+        if args:
+            e["args"] = args
+        if e["ph"] == "i":
+            e["s"] = "t"
+        out.append(e)
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("dump", help="serial capture containing a trace")
+    ap.add_argument("-o", "--output", default="-", help="JSON file (default: stdout)")
+    args = ap.parse_args()
+
+    with open(args.dump, "rb") as f:
+        data = f.read()
+    try:
+        khz, events, records = parse(data)
+    except (ValueError, IndexError) as e:
+        sys.exit("%s: %s" % (args.dump, e))
+    trace = to_chrome(khz, events, records)
+    if args.output == "-":
+        json.dump(trace, sys.stdout)
+    else:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+        print("%d events -> %s" % (len(records), args.output))
+
+
+if __name__ == "__main__":
+    main()